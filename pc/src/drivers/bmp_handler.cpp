@@ -3,6 +3,17 @@
 #include <iostream>
 #include <algorithm>
 #include <cstring>
+#include "../include/parallel.h"
+#include "../include/luma.h"
+#include "../include/canny.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 BMPImage::BMPImage() : isGrayscale(false) {
     // 初始化文件头
@@ -70,10 +81,7 @@ void BMPImage::readGrayscaleData(std::ifstream& file) {
     int height = abs(infoHeader.height);
     uint32_t rowSize = calculateRowSize(width, 8);
     
-    grayData.resize(height);
-    for (int i = 0; i < height; i++) {
-        grayData[i].resize(width);
-    }
+    grayData = Image<uint8_t>(width, height);
 
     // 移动到图像数据开始位置
     file.seekg(fileHeader.offsetData);
@@ -83,9 +91,7 @@ void BMPImage::readGrayscaleData(std::ifstream& file) {
     // BMP图像数据是从底部到顶部存储的
     for (int y = height - 1; y >= 0; y--) {
         file.read(reinterpret_cast<char*>(rowBuffer.data()), rowSize);
-        for (int x = 0; x < width; x++) {
-            grayData[y][x] = rowBuffer[x];
-        }
+        std::copy(rowBuffer.begin(), rowBuffer.begin() + width, grayData[y]);
     }
 }
 
@@ -118,12 +124,6 @@ void BMPImage::readColorData(std::ifstream& file) {
 }
 
 bool BMPImage::writeBMP(const std::string& filename) const {
-    std::ofstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Error: Cannot create file: " << filename << std::endl;
-        return false;
-    }
-
     // 计算文件大小
     int width = infoHeader.width;
     int height = abs(infoHeader.height);
@@ -148,76 +148,77 @@ bool BMPImage::writeBMP(const std::string& filename) const {
     writeFileHeader.fileSize = writeFileHeader.offsetData + imageSize;
     writeInfoHeader.sizeImage = imageSize;
 
-    // 写入文件头和信息头
-    file.write(reinterpret_cast<const char*>(&writeFileHeader), sizeof(writeFileHeader));
-    file.write(reinterpret_cast<const char*>(&writeInfoHeader), sizeof(writeInfoHeader));
+    // 整个文件先编码到一块缓冲区（行尾填充为 0），再一次写出
+    std::vector<uint8_t> buffer(writeFileHeader.fileSize, 0);
+    uint8_t* out = buffer.data();
+    memcpy(out, &writeFileHeader, sizeof(writeFileHeader));
+    out += sizeof(writeFileHeader);
+    memcpy(out, &writeInfoHeader, sizeof(writeInfoHeader));
+    out += sizeof(writeInfoHeader);
 
     if (isGrayscale) {
-        // 写入调色板
-        file.write(reinterpret_cast<const char*>(colorTable.data()), paletteSize);
-        writeGrayscaleData(file);
+        // 调色板
+        memcpy(out, colorTable.data(), std::min<size_t>(paletteSize, colorTable.size() * sizeof(RGBQuad)));
+        out += paletteSize;
+        encodeGrayscaleData(out);
     } else {
-        writeColorData(file);
+        encodeColorData(out);
     }
 
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot create file: " << filename << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
     file.close();
     return true;
 }
 
-void BMPImage::writeGrayscaleData(std::ofstream& file) const {
+void BMPImage::encodeGrayscaleData(uint8_t* out) const {
     int width = infoHeader.width;
     int height = abs(infoHeader.height);
     uint32_t rowSize = calculateRowSize(width, 8);
-    
-    std::vector<uint8_t> rowBuffer(rowSize, 0);
 
     // BMP图像数据是从底部到顶部存储的
-    for (int y = height - 1; y >= 0; y--) {
-        std::fill(rowBuffer.begin(), rowBuffer.end(), 0);
-        for (int x = 0; x < width; x++) {
-            rowBuffer[x] = grayData[y][x];
-        }
-        file.write(reinterpret_cast<const char*>(rowBuffer.data()), rowSize);
+    for (int y = height - 1; y >= 0; y--, out += rowSize) {
+        memcpy(out, grayData[y], width);
     }
 }
 
-void BMPImage::writeColorData(std::ofstream& file) const {
+void BMPImage::encodeColorData(uint8_t* out) const {
     int width = infoHeader.width;
     int height = abs(infoHeader.height);
     uint32_t rowSize = calculateRowSize(width, 24);
-    
-    std::vector<uint8_t> rowBuffer(rowSize, 0);
 
     // BMP图像数据是从底部到顶部存储的
-    for (int y = height - 1; y >= 0; y--) {
-        std::fill(rowBuffer.begin(), rowBuffer.end(), 0);
+    for (int y = height - 1; y >= 0; y--, out += rowSize) {
+        const PixelRGB* src = colorData[y].data();
         for (int x = 0; x < width; x++) {
             // BMP中BGR格式存储
-            int offset = x * 3;
-            rowBuffer[offset] = colorData[y][x].b;
-            rowBuffer[offset + 1] = colorData[y][x].g;
-            rowBuffer[offset + 2] = colorData[y][x].r;
+            out[x * 3] = src[x].b;
+            out[x * 3 + 1] = src[x].g;
+            out[x * 3 + 2] = src[x].r;
         }
-        file.write(reinterpret_cast<const char*>(rowBuffer.data()), rowSize);
     }
 }
 
-std::vector<std::vector<uint8_t>> BMPImage::toGrayscaleMatrix() const {
+Image<uint8_t> BMPImage::toGrayscaleMatrix() const {
     if (!isGrayscale) {
         std::cerr << "Warning: Current image is not an 8-bit grayscale image" << std::endl;
-        return std::vector<std::vector<uint8_t>>();
+        return Image<uint8_t>();
     }
     return grayData;
 }
 
-void BMPImage::fromGrayscaleMatrix(const std::vector<std::vector<uint8_t>>& matrix) {
-    if (matrix.empty() || matrix[0].empty()) {
+void BMPImage::fromGrayscaleMatrix(const Image<uint8_t>& matrix) {
+    if (matrix.empty()) {
         std::cerr << "Error: Input matrix is empty" << std::endl;
         return;
     }
 
-    int height = matrix.size();
-    int width = matrix[0].size();
+    int height = matrix.height();
+    int width = matrix.width();
     
     // 设置为灰度模式
     isGrayscale = true;
@@ -278,3 +279,203 @@ void BMPImage::fromColorMatrix(const std::vector<std::vector<PixelRGB>>& matrix)
     fileHeader.offsetData = sizeof(BMPFileHeader) + sizeof(BMPInfoHeader);
     fileHeader.fileSize = fileHeader.offsetData + infoHeader.sizeImage;
 }
+
+// 只读文件映射
+class MappedFile {
+private:
+    const uint8_t* data_;
+    size_t size_;
+#ifdef _WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#endif
+
+public:
+#ifdef _WIN32
+    explicit MappedFile(const std::string& filename) : data_(nullptr), size_(0), file_(INVALID_HANDLE_VALUE), mapping_(nullptr) {
+        file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+            return;
+        }
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr) {
+            return;
+        }
+        data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        size_ = data_ ? static_cast<size_t>(size.QuadPart) : 0;
+    }
+
+    ~MappedFile() {
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    }
+#else
+    explicit MappedFile(const std::string& filename) : data_(nullptr), size_(0) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* p = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data_ = static_cast<const uint8_t*>(p);
+                size_ = info.st_size;
+                madvise(p, size_, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+    }
+#endif
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // 丢弃 [offset, offset + length) 内完整的页；只读映射的页随时可以从文件重新读入
+    void release(size_t offset, size_t length) const {
+#ifndef _WIN32
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = (offset + page - 1) / page * page;
+        size_t end = std::min(offset + length, size_) / page * page;
+        if (data_ && end > begin) {
+            madvise(const_cast<uint8_t*>(data_) + begin, end - begin, MADV_DONTNEED);
+        }
+#else
+        (void)offset;
+        (void)length;
+#endif
+    }
+};
+
+BMPGrayReader::BMPGrayReader()
+    : pixels(nullptr), rowSize(0), width(0), height(0), bpp(0), topDown(false), identity(true) {}
+
+BMPGrayReader::~BMPGrayReader() {}
+
+bool BMPGrayReader::open(const std::string& filename) {
+    file.reset(new MappedFile(filename));
+    if (file->data() == nullptr) {
+        std::cerr << "Error: Cannot open file: " << filename << std::endl;
+        return false;
+    }
+
+    // 头部可能不对齐，按字节拷贝
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    if (file->size() < sizeof(fileHeader) + sizeof(infoHeader)) {
+        std::cerr << "Error: Not a valid BMP file" << std::endl;
+        return false;
+    }
+    memcpy(&fileHeader, file->data(), sizeof(fileHeader));
+    memcpy(&infoHeader, file->data() + sizeof(fileHeader), sizeof(infoHeader));
+    if (fileHeader.fileType != 0x4D42 || infoHeader.size < sizeof(infoHeader)) {
+        std::cerr << "Error: Not a valid BMP file" << std::endl;
+        return false;
+    }
+
+    bpp = infoHeader.bitsPerPixel;
+    width = infoHeader.width;
+    height = abs(infoHeader.height);
+    topDown = infoHeader.height < 0;
+    if (width <= 0 || height <= 0) {
+        std::cerr << "Error: Invalid BMP size" << std::endl;
+        return false;
+    }
+
+    // BI_BITFIELDS 只接受标准 BGRA 掩码，此时与 BI_RGB 布局相同
+    if (bpp == 32 && infoHeader.compression == 3) {
+        size_t maskOffset = sizeof(fileHeader) + sizeof(infoHeader);
+        uint32_t masks[3];
+        if (file->size() < maskOffset + sizeof(masks)) {
+            std::cerr << "Error: Not a valid BMP file" << std::endl;
+            return false;
+        }
+        memcpy(masks, file->data() + maskOffset, sizeof(masks));
+        if (masks[0] != 0x00FF0000 || masks[1] != 0x0000FF00 || masks[2] != 0x000000FF) {
+            std::cerr << "Error: Unsupported BMP channel masks" << std::endl;
+            return false;
+        }
+    } else if (infoHeader.compression != 0) {
+        std::cerr << "Error: Compressed BMP files are not supported" << std::endl;
+        return false;
+    }
+    if (bpp != 8 && bpp != 24 && bpp != 32) {
+        std::cerr << "Error: Unsupported bits per pixel: " << bpp << std::endl;
+        return false;
+    }
+
+    rowSize = ((static_cast<size_t>(width) * bpp + 31) / 32) * 4;
+    if (fileHeader.offsetData > file->size() || rowSize * height > file->size() - fileHeader.offsetData) {
+        std::cerr << "Error: Truncated BMP file" << std::endl;
+        return false;
+    }
+    pixels = file->data() + fileHeader.offsetData;
+
+    // 调色板紧跟在信息头之后（信息头可能比 40 字节长）
+    identity = true;
+    for (int i = 0; i < 256; i++) {
+        palette[i] = static_cast<uint8_t>(i);
+    }
+    if (bpp == 8) {
+        size_t paletteOffset = sizeof(fileHeader) + infoHeader.size;
+        size_t entries = infoHeader.colorsUsed ? std::min<uint32_t>(infoHeader.colorsUsed, 256) : 256;
+        entries = std::min(entries, (fileHeader.offsetData - std::min<size_t>(paletteOffset, fileHeader.offsetData)) / sizeof(RGBQuad));
+        for (size_t i = 0; i < entries; i++) {
+            const uint8_t* q = file->data() + paletteOffset + i * sizeof(RGBQuad);
+            palette[i] = luma(q[2], q[1], q[0]);
+            identity = identity && palette[i] == i;
+        }
+    }
+    return true;
+}
+
+// 每个线程至少解码的行数，太少时线程开销大于解码本身
+const int DECODE_MIN_BAND = 64;
+
+void BMPGrayReader::readRows(int begin, int end, Image<uint8_t>& rows) const {
+    parallel_bands(end - begin, canny_threads, DECODE_MIN_BAND, [&](int, int first, int last) {
+        for (int y = begin + first; y < begin + last; y++) {
+            const uint8_t* src = pixels + rowSize * (topDown ? y : height - 1 - y);
+            uint8_t* dst = rows[y - begin];
+            if (bpp == 8 && identity) {
+                memcpy(dst, src, width);
+            } else if (bpp == 8) {
+                for (int x = 0; x < width; x++) {
+                    dst[x] = palette[src[x]];
+                }
+            } else {
+                // 解码时直接换算成灰度，不生成彩色矩阵
+                luma_row(src, bpp / 8, dst, width);
+            }
+        }
+    });
+}
+
+void BMPGrayReader::release(int begin, int end) const {
+    if (begin >= end) {
+        return;
+    }
+    // 自底向上存储时，上方的行在文件后部
+    int first = topDown ? begin : height - end;
+    file->release(pixels - file->data() + rowSize * first, rowSize * (end - begin));
+}
+
+bool readBMPGray(const std::string& filename, Image<uint8_t>& gray) {
+    BMPGrayReader reader;
+    if (!reader.open(filename)) {
+        return false;
+    }
+    gray = Image<uint8_t>(reader.getWidth(), reader.getHeight());
+    reader.readRows(0, reader.getHeight(), gray);
+    return true;
+}
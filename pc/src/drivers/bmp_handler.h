@@ -4,6 +4,8 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <memory>
+#include "../include/image.h"
 
 // BMP 文件头结构
 #pragma pack(push, 1)
@@ -50,7 +52,7 @@ private:
     BMPFileHeader fileHeader;
     BMPInfoHeader infoHeader;
     std::vector<RGBQuad> colorTable;
-    std::vector<std::vector<uint8_t>> grayData;    // 灰度数据
+    Image<uint8_t> grayData;                       // 灰度数据
     std::vector<std::vector<PixelRGB>> colorData;  // 彩色数据
     bool isGrayscale;
 
@@ -58,8 +60,8 @@ private:
     uint32_t calculateRowSize(int width, int bitsPerPixel) const;
     void readGrayscaleData(std::ifstream& file);
     void readColorData(std::ifstream& file);
-    void writeGrayscaleData(std::ofstream& file) const;
-    void writeColorData(std::ofstream& file) const;
+    void encodeGrayscaleData(uint8_t* out) const;   // 像素数据写入预先分配好的缓冲区
+    void encodeColorData(uint8_t* out) const;
 
 public:
     BMPImage();
@@ -71,11 +73,11 @@ public:
     // 输出 BMP 文件
     bool writeBMP(const std::string& filename) const;
     
-    // 将8位灰度图像转换为 vector<vector<uint8_t>> 格式
-    std::vector<std::vector<uint8_t>> toGrayscaleMatrix() const;
+    // 将8位灰度图像转换为 Image<uint8_t> 格式
+    Image<uint8_t> toGrayscaleMatrix() const;
     
-    // 从 vector<vector<uint8_t>> 创建灰度图像
-    void fromGrayscaleMatrix(const std::vector<std::vector<uint8_t>>& matrix);
+    // 从 Image<uint8_t> 创建灰度图像
+    void fromGrayscaleMatrix(const Image<uint8_t>& matrix);
     
     // 从 vector<vector<PixelRGB>> 创建彩色图像
     void fromColorMatrix(const std::vector<std::vector<PixelRGB>>& matrix);
@@ -87,8 +89,46 @@ public:
     bool isGrayscaleImage() const { return isGrayscale; }
     
     // 获取像素数据
-    const std::vector<std::vector<uint8_t>>& getGrayscaleData() const { return grayData; }
+    const Image<uint8_t>& getGrayscaleData() const { return grayData; }
     const std::vector<std::vector<PixelRGB>>& getColorData() const { return colorData; }
 };
 
+class MappedFile;
+
+// 按行带解码 BMP 灰度数据：文件保持内存映射，调用方每次只取需要的若干行，
+// 整张图不必同时放在内存里。超大图像边读边缩小时使用
+class BMPGrayReader {
+private:
+    std::unique_ptr<MappedFile> file;
+    const uint8_t* pixels;           // 像素数据起点
+    size_t rowSize;                  // 每行字节数（含 4 字节对齐填充）
+    int width;
+    int height;
+    int bpp;
+    bool topDown;
+    uint8_t palette[256];            // 8 位图像的调色板灰度值
+    bool identity;                   // 调色板是否恰好是 0..255 的灰阶
+
+public:
+    BMPGrayReader();
+    ~BMPGrayReader();
+
+    // 打开文件并解析文件头、信息头和调色板
+    bool open(const std::string& filename);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // 解码第 [begin, end) 行（自上而下编号）到 rows 的第 0 .. end - begin - 1 行，按 canny_threads 分带并行
+    void readRows(int begin, int end, Image<uint8_t>& rows) const;
+
+    // 释放第 [begin, end) 行占用的映射页；之后再读这些行会重新从文件载入
+    void release(int begin, int end) const;
+};
+
+// 读取 BMP 并直接解码为 8 位灰度：文件通过 mmap 映射，只扫描一遍像素数据，
+// 不生成彩色矩阵。支持 8 位（应用调色板）、24 位和 32 位（BI_RGB 或标准 BGRA 掩码），
+// 自底向上和自顶向下两种存储顺序
+bool readBMPGray(const std::string& filename, Image<uint8_t>& gray);
+
 #endif // BMP_HANDLER_H
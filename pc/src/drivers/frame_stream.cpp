@@ -0,0 +1,189 @@
+#include "frame_stream.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+static bool endsWith(const std::string& s, const std::string& suffix) {
+    if (s.size() < suffix.size()) {
+        return false;
+    }
+    std::string tail = s.substr(s.size() - suffix.size());
+    std::transform(tail.begin(), tail.end(), tail.begin(), ::tolower);
+    return tail == suffix;
+}
+
+bool isFrameStreamSource(const std::string& spec) {
+    return spec == "-" || endsWith(spec, ".y4m") || spec.compare(0, 6, "gray8:") == 0;
+}
+
+FrameStream::FrameStream()
+    : file(nullptr), ownsFile(false), y4m(false), width(0), height(0), fps(0), skipBytes(0) {}
+
+FrameStream::~FrameStream() {
+    if (file && ownsFile) {
+        fclose(file);
+    }
+}
+
+bool FrameStream::openFile(const std::string& path) {
+    if (path == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        file = stdin;
+        ownsFile = false;
+    } else {
+        file = fopen(path.c_str(), "rb");
+        ownsFile = true;
+    }
+    if (file == nullptr) {
+        std::cerr << "Error: Cannot open stream: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FrameStream::open(const std::string& spec) {
+    if (spec.compare(0, 6, "gray8:") == 0) {
+        // gray8:<宽>x<高>[@<帧率>]:<路径>
+        size_t colon = spec.find(':', 6);
+        if (colon == std::string::npos) {
+            std::cerr << "Error: Expected gray8:<width>x<height>[@<fps>]:<path>" << std::endl;
+            return false;
+        }
+        std::string geometry = spec.substr(6, colon - 6);
+        double rate = 30;
+        char sep = 0, at = 0;
+        std::stringstream ss(geometry);
+        ss >> width >> sep >> height;
+        if (ss >> at) {
+            ss >> rate;
+        }
+        if (!ss.eof() || sep != 'x' || (at != 0 && at != '@') || width <= 0 || height <= 0 || rate <= 0) {
+            std::cerr << "Error: Bad gray8 geometry: " << geometry << std::endl;
+            return false;
+        }
+        y4m = false;
+        fps = rate;
+        skipBytes = 0;
+        return openFile(spec.substr(colon + 1));
+    }
+
+    y4m = true;
+    return openFile(spec) && readY4MHeader();
+}
+
+bool FrameStream::readLine(std::string& line) {
+    line.clear();
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '\n') {
+            return true;
+        }
+        line.push_back(static_cast<char>(c));
+    }
+    return !line.empty();
+}
+
+// 流头：YUV4MPEG2 W<宽> H<高> F<分子>:<分母> C<色度格式> ...
+bool FrameStream::readY4MHeader() {
+    std::string line;
+    if (!readLine(line) || line.compare(0, 10, "YUV4MPEG2 ") != 0) {
+        std::cerr << "Error: Not a YUV4MPEG2 stream" << std::endl;
+        return false;
+    }
+
+    std::string colorspace = "420";
+    fps = 25;
+    std::stringstream ss(line.substr(10));
+    std::string token;
+    while (ss >> token) {
+        char tag = token[0];
+        std::string value = token.substr(1);
+        if (tag == 'W') {
+            width = atoi(value.c_str());
+        } else if (tag == 'H') {
+            height = atoi(value.c_str());
+        } else if (tag == 'F') {
+            int num = 0, den = 0;
+            if (sscanf(value.c_str(), "%d:%d", &num, &den) == 2 && num > 0 && den > 0) {
+                fps = static_cast<double>(num) / den;
+            }
+        } else if (tag == 'C') {
+            colorspace = value;
+        }
+    }
+    if (width <= 0 || height <= 0) {
+        std::cerr << "Error: YUV4MPEG2 stream without a frame size" << std::endl;
+        return false;
+    }
+
+    size_t cw = (width + 1) / 2;
+    size_t ch = (height + 1) / 2;
+    if (colorspace.compare(0, 4, "mono") == 0) {
+        skipBytes = colorspace == "mono" ? 0 : std::string::npos;
+    } else if (colorspace.compare(0, 3, "420") == 0) {
+        // 420 / 420jpeg / 420mpeg2 / 420paldv 只是色度采样位置不同；420p10 等高位深不支持
+        bool eightBit = colorspace == "420" || colorspace == "420jpeg" || colorspace == "420mpeg2" || colorspace == "420paldv";
+        skipBytes = eightBit ? 2 * cw * ch : std::string::npos;
+    } else if (colorspace == "422") {
+        skipBytes = 2 * cw * height;
+    } else if (colorspace == "444") {
+        skipBytes = 2 * static_cast<size_t>(width) * height;
+    } else if (colorspace == "444alpha") {
+        skipBytes = 3 * static_cast<size_t>(width) * height;
+    } else {
+        skipBytes = std::string::npos;
+    }
+    if (skipBytes == std::string::npos) {
+        std::cerr << "Error: Unsupported YUV4MPEG2 colorspace: C" << colorspace << " (8-bit only)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FrameStream::skip(size_t bytes) {
+    scratch.resize(std::min<size_t>(bytes, 1 << 16));
+    while (bytes > 0) {
+        size_t chunk = std::min(bytes, scratch.size());
+        if (fread(scratch.data(), 1, chunk, file) != chunk) {
+            return false;
+        }
+        bytes -= chunk;
+    }
+    return true;
+}
+
+bool FrameStream::nextFrame(Image<uint8_t>& gray) {
+    if (file == nullptr) {
+        return false;
+    }
+    if (y4m) {
+        std::string line;
+        if (!readLine(line)) {
+            return false;
+        }
+        if (line.compare(0, 5, "FRAME") != 0) {
+            std::cerr << "Error: Corrupt YUV4MPEG2 frame header" << std::endl;
+            return false;
+        }
+    }
+
+    if (gray.width() != width || gray.height() != height) {
+        gray = Image<uint8_t>(width, height);
+    }
+    for (int y = 0; y < height; y++) {
+        if (fread(gray[y], 1, width, file) != static_cast<size_t>(width)) {
+            if (y > 0) {
+                std::cerr << "Warning: Truncated frame at end of stream" << std::endl;
+            }
+            return false;
+        }
+    }
+    return skip(skipBytes);
+}
@@ -0,0 +1,48 @@
+#ifndef FRAME_STREAM_H
+#define FRAME_STREAM_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "../include/image.h"
+
+// 顺序读取的原始视频帧流（标准输入、命名管道或普通文件），只保留亮度。
+// 支持两种来源写法：
+//   <路径>.y4m 或 "-"              YUV4MPEG2（8 位，色度平面直接跳过）
+//   gray8:<宽>x<高>[@<帧率>]:<路径>  连续的 8 位灰度帧，路径为 "-" 时读标准输入
+class FrameStream {
+private:
+    FILE* file;
+    bool ownsFile;
+    bool y4m;
+    int width;
+    int height;
+    double fps;
+    size_t skipBytes;                // 每帧亮度平面之后要跳过的字节数（色度）
+    std::vector<uint8_t> scratch;
+
+    bool openFile(const std::string& path);
+    bool readY4MHeader();
+    bool readLine(std::string& line);
+    bool skip(size_t bytes);
+
+public:
+    FrameStream();
+    ~FrameStream();
+
+    // 按上面的写法打开来源并读取流头
+    bool open(const std::string& spec);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    double getFps() const { return fps; }
+
+    // 读取下一帧；流结束或出错时返回 false
+    bool nextFrame(Image<uint8_t>& gray);
+};
+
+// 判断来源是否按帧流处理
+bool isFrameStreamSource(const std::string& spec);
+
+#endif // FRAME_STREAM_H
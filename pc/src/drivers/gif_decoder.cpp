@@ -0,0 +1,365 @@
+#include "gif_decoder.h"
+#include "../include/luma.h"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+GifDecoder::GifDecoder()
+    : pos(0), width(0), height(0), hasGlobalPalette(false), background(0), decoded(0),
+      disposal(0), lastLeft(0), lastTop(0), lastWidth(0), lastHeight(0) {
+    memset(globalGray, 0, sizeof(globalGray));
+}
+
+static inline int readU16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+bool GifDecoder::open(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open file: " << filename << std::endl;
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    data.resize(size > 0 ? static_cast<size_t>(size) : 0);
+    if (size <= 0 || !file.read(reinterpret_cast<char*>(data.data()), size)) {
+        std::cerr << "Error: Cannot read file: " << filename << std::endl;
+        return false;
+    }
+
+    // 文件头和逻辑屏幕描述符
+    if (data.size() < 13 || (memcmp(data.data(), "GIF87a", 6) != 0 && memcmp(data.data(), "GIF89a", 6) != 0)) {
+        std::cerr << "Error: Not a valid GIF file" << std::endl;
+        return false;
+    }
+    width = readU16(&data[6]);
+    height = readU16(&data[8]);
+    int packed = data[10];
+    int bgIndex = data[11];
+    pos = 13;
+    if (packed & 0x80) {
+        int entries = 2 << (packed & 0x07);
+        if (pos + entries * 3 > data.size()) {
+            std::cerr << "Error: Truncated GIF file" << std::endl;
+            return false;
+        }
+        readPalette(pos, entries, globalGray);
+        hasGlobalPalette = true;
+        pos += entries * 3;
+        background = globalGray[bgIndex];
+    }
+    if (width <= 0 || height <= 0) {
+        std::cerr << "Error: Invalid GIF size" << std::endl;
+        return false;
+    }
+
+    canvas = Image<uint8_t>(width, height, background);
+    decoded = 0;
+    disposal = 0;
+    return scan();
+}
+
+// 定点亮度公式，见 luma.h
+void GifDecoder::readPalette(size_t p, int entries, uint8_t* gray) const {
+    for (int i = 0; i < entries; i++) {
+        const uint8_t* c = &data[p + i * 3];
+        gray[i] = luma(c[0], c[1], c[2]);
+    }
+}
+
+bool GifDecoder::skipSubBlocks(size_t& p) const {
+    while (p < data.size()) {
+        int length = data[p++];
+        if (length == 0) {
+            return true;
+        }
+        p += length;
+    }
+    return false;
+}
+
+// 遍历块结构统计帧数；时长取自每帧前的图形控制扩展（单位 10 ms）
+bool GifDecoder::scan() {
+    delays.clear();
+    size_t p = pos;
+    int delay = 0;
+    while (p < data.size()) {
+        uint8_t block = data[p++];
+        if (block == 0x3B) {
+            break;
+        } else if (block == 0x21) {
+            if (p >= data.size()) {
+                break;
+            }
+            uint8_t label = data[p++];
+            if (label == 0xF9 && p + 5 <= data.size()) {
+                delay = readU16(&data[p + 2]) * 10;
+            }
+            if (!skipSubBlocks(p)) {
+                break;
+            }
+        } else if (block == 0x2C) {
+            if (p + 9 > data.size()) {
+                break;
+            }
+            int packed = data[p + 8];
+            p += 9;
+            if (packed & 0x80) {
+                p += (2 << (packed & 0x07)) * 3;
+            }
+            p++;   // LZW 最小码长
+            if (!skipSubBlocks(p)) {
+                break;
+            }
+            delays.push_back(delay);
+            delay = 0;
+        } else {
+            break;
+        }
+    }
+    if (delays.empty()) {
+        std::cerr << "Error: GIF file has no frames" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// LZW 解码，输出调色板索引；码字从拼接后的数据子块里按低位在前读取
+bool GifDecoder::decodeLZW(size_t& p, int minCodeSize, std::vector<uint8_t>& indices) const {
+    std::vector<uint8_t> stream;
+    while (p < data.size()) {
+        int length = data[p++];
+        if (length == 0) {
+            break;
+        }
+        if (p + length > data.size()) {
+            return false;
+        }
+        stream.insert(stream.end(), data.begin() + p, data.begin() + p + length);
+        p += length;
+    }
+    if (minCodeSize < 2 || minCodeSize > 11) {
+        return false;
+    }
+
+    const int MAX_CODES = 4096;
+    uint16_t prefix[MAX_CODES];
+    uint8_t suffix[MAX_CODES];
+    uint8_t first[MAX_CODES];      // 每个码字对应串的首字符
+    uint8_t stack[MAX_CODES + 1];
+    int clearCode = 1 << minCodeSize;
+    int endCode = clearCode + 1;
+    for (int c = 0; c < clearCode; c++) {
+        prefix[c] = 0;
+        suffix[c] = static_cast<uint8_t>(c);
+        first[c] = static_cast<uint8_t>(c);
+    }
+
+    size_t limit = indices.size();
+    size_t out = 0;
+    int codeSize = minCodeSize + 1;
+    int nextCode = endCode + 1;
+    int previous = -1;
+    uint32_t bits = 0;
+    int bitCount = 0;
+    size_t in = 0;
+    while (out < limit) {
+        while (bitCount < codeSize && in < stream.size()) {
+            bits |= static_cast<uint32_t>(stream[in++]) << bitCount;
+            bitCount += 8;
+        }
+        if (bitCount < codeSize) {
+            break;
+        }
+        int code = bits & ((1 << codeSize) - 1);
+        bits >>= codeSize;
+        bitCount -= codeSize;
+
+        if (code == clearCode) {
+            codeSize = minCodeSize + 1;
+            nextCode = endCode + 1;
+            previous = -1;
+            continue;
+        }
+        if (code == endCode) {
+            break;
+        }
+        if (previous < 0) {
+            if (code >= clearCode) {
+                return false;
+            }
+            indices[out++] = static_cast<uint8_t>(code);
+            previous = code;
+            continue;
+        }
+
+        // 码字 == nextCode 时是 KwKwK 情况：上一串加上它自己的首字符
+        int current = code;
+        int depth = 0;
+        if (code == nextCode) {
+            stack[depth++] = first[previous];
+            current = previous;
+        } else if (code > nextCode) {
+            return false;
+        }
+        while (current >= clearCode) {
+            stack[depth++] = suffix[current];
+            current = prefix[current];
+        }
+        stack[depth++] = static_cast<uint8_t>(current);
+        while (depth > 0 && out < limit) {
+            indices[out++] = stack[--depth];
+        }
+
+        if (nextCode < MAX_CODES) {
+            prefix[nextCode] = static_cast<uint16_t>(previous);
+            suffix[nextCode] = static_cast<uint8_t>(current);
+            first[nextCode] = first[previous];
+            nextCode++;
+            if (nextCode == (1 << codeSize) && codeSize < 12) {
+                codeSize++;
+            }
+        }
+        previous = code;
+    }
+    return true;
+}
+
+// 按上一帧的处置方式清理画布：2 = 恢复为背景色，3 = 恢复为绘制前的画面
+void GifDecoder::disposePrevious() {
+    if (disposal != 2 && disposal != 3) {
+        return;
+    }
+    int x0 = std::max(lastLeft, 0), x1 = std::min(lastLeft + lastWidth, width);
+    int y0 = std::max(lastTop, 0), y1 = std::min(lastTop + lastHeight, height);
+    for (int y = y0; y < y1; y++) {
+        if (disposal == 2) {
+            std::fill(canvas[y] + x0, canvas[y] + std::max(x0, x1), background);
+        } else if (x1 > x0) {
+            std::copy(saved[y] + x0, saved[y] + x1, canvas[y] + x0);
+        }
+    }
+}
+
+bool GifDecoder::nextFrame(GifFrame& frame) {
+    if (decoded >= frameCount()) {
+        return false;
+    }
+
+    int frameDisposal = 0;
+    int delay = 0;
+    int transparent = -1;
+    while (pos < data.size()) {
+        uint8_t block = data[pos++];
+        if (block == 0x3B) {
+            return false;
+        }
+        if (block == 0x21) {
+            if (pos >= data.size()) {
+                return false;
+            }
+            uint8_t label = data[pos++];
+            if (label == 0xF9 && pos + 5 <= data.size()) {
+                int packed = data[pos + 1];
+                frameDisposal = (packed >> 2) & 0x07;
+                delay = readU16(&data[pos + 2]) * 10;
+                transparent = (packed & 0x01) ? data[pos + 4] : -1;
+            }
+            if (!skipSubBlocks(pos)) {
+                return false;
+            }
+            continue;
+        }
+        if (block != 0x2C || pos + 9 > data.size()) {
+            std::cerr << "Error: Corrupt GIF block" << std::endl;
+            return false;
+        }
+
+        // 图像描述符
+        int left = readU16(&data[pos]);
+        int top = readU16(&data[pos + 2]);
+        int frameWidth = readU16(&data[pos + 4]);
+        int frameHeight = readU16(&data[pos + 6]);
+        int packed = data[pos + 8];
+        pos += 9;
+
+        uint8_t localGray[256];
+        const uint8_t* palette = globalGray;
+        if (packed & 0x80) {
+            int entries = 2 << (packed & 0x07);
+            if (pos + entries * 3 > data.size()) {
+                return false;
+            }
+            memset(localGray, 0, sizeof(localGray));
+            readPalette(pos, entries, localGray);
+            palette = localGray;
+            pos += entries * 3;
+        } else if (!hasGlobalPalette) {
+            std::cerr << "Error: GIF frame without a palette" << std::endl;
+            return false;
+        }
+        bool interlaced = (packed & 0x40) != 0;
+
+        if (pos >= data.size()) {
+            return false;
+        }
+        int minCodeSize = data[pos++];
+        std::vector<uint8_t> indices(static_cast<size_t>(frameWidth) * frameHeight, transparent < 0 ? 0 : transparent);
+        if (!decodeLZW(pos, minCodeSize, indices)) {
+            std::cerr << "Error: Corrupt GIF image data" << std::endl;
+            return false;
+        }
+
+        disposePrevious();
+        if (frameDisposal == 3) {
+            saved = canvas;
+        }
+
+        // 隔行扫描的行顺序：0, 8, 16... / 4, 12... / 2, 6... / 1, 3...
+        std::vector<int> rows;
+        rows.reserve(frameHeight);
+        if (interlaced) {
+            const int start[4] = {0, 4, 2, 1};
+            const int step[4] = {8, 8, 4, 2};
+            for (int pass = 0; pass < 4; pass++) {
+                for (int r = start[pass]; r < frameHeight; r += step[pass]) {
+                    rows.push_back(r);
+                }
+            }
+        } else {
+            for (int r = 0; r < frameHeight; r++) {
+                rows.push_back(r);
+            }
+        }
+
+        int x0 = std::max(left, 0), x1 = std::min(left + frameWidth, width);
+        for (int r = 0; r < frameHeight; r++) {
+            int y = top + rows[r];
+            if (y < 0 || y >= height) {
+                continue;
+            }
+            const uint8_t* src = &indices[static_cast<size_t>(r) * frameWidth];
+            uint8_t* dst = canvas[y];
+            for (int x = x0; x < x1; x++) {
+                int index = src[x - left];
+                if (index != transparent) {
+                    dst[x] = palette[index];
+                }
+            }
+        }
+
+        disposal = frameDisposal;
+        lastLeft = left;
+        lastTop = top;
+        lastWidth = frameWidth;
+        lastHeight = frameHeight;
+        decoded++;
+
+        frame.gray = canvas;
+        frame.delayMs = delay;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,56 @@
+#ifndef GIF_DECODER_H
+#define GIF_DECODER_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "../include/image.h"
+
+// 解码后的一帧（已按处置方式合成到整张画布上）
+struct GifFrame {
+    Image<uint8_t> gray;   // 灰度画面
+    int delayMs;           // 本帧显示时长（毫秒）
+};
+
+// GIF 解码器：LZW、全局/局部调色板、透明色、隔行扫描和处置方式（disposal）。
+// 调色板在解码时直接换算成灰度，画布只保存 8 位灰度，不生成彩色帧。
+class GifDecoder {
+private:
+    std::vector<uint8_t> data;       // 整个文件
+    size_t pos;                      // 下一个块的位置
+    int width;
+    int height;
+    uint8_t globalGray[256];         // 全局调色板的灰度值
+    bool hasGlobalPalette;
+    uint8_t background;              // 背景色的灰度值
+    std::vector<int> delays;         // 预扫描得到的每帧时长
+    int decoded;                     // 已输出的帧数
+
+    Image<uint8_t> canvas;           // 当前合成结果
+    Image<uint8_t> saved;            // 处置方式 3 需要恢复的画面
+    int disposal;                    // 上一帧的处置方式
+    int lastLeft, lastTop, lastWidth, lastHeight;
+
+    // 辅助函数
+    bool scan();
+    bool skipSubBlocks(size_t& p) const;
+    void readPalette(size_t p, int entries, uint8_t* gray) const;
+    bool decodeLZW(size_t& p, int minCodeSize, std::vector<uint8_t>& indices) const;
+    void disposePrevious();
+
+public:
+    GifDecoder();
+
+    // 读取文件并预扫描帧数和时长（只遍历块结构，不解压）
+    bool open(const std::string& filename);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int frameCount() const { return static_cast<int>(delays.size()); }
+    const std::vector<int>& frameDelays() const { return delays; }
+
+    // 解码下一帧；结束或出错时返回 false
+    bool nextFrame(GifFrame& frame);
+};
+
+#endif // GIF_DECODER_H
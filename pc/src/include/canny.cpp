@@ -1,71 +1,201 @@
 #include "canny.h"
+#include "parallel.h"
+#include "dump.h"
+#include "kernel.h"
 #include "../drivers/bmp_handler.h"
 #include <bits/stdc++.h>
 #include <cstdlib>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 const double PI = acos(-1);
 
 grayMatrix_t grayMatrix;
+int canny_threads = 0;
+int canny_max_side = 0;
 
-// RGB to grayscale conversion using standard luminance formula
-uint8_t rgbToGrayscale(const PixelRGB& pixel) {
-    return static_cast<uint8_t>(0.299 * pixel.r + 0.587 * pixel.g + 0.114 * pixel.b);
+void save_matrix_to_file(const grayMatrix_t& matrix, const string& filename) {
+    std::ofstream fout(filename);
+    for (int i = 0; i < matrix.height(); i++) {
+        for (int j = 0; j < matrix.width(); j++) {
+            fout << (int)matrix[i][j] << " ";
+        }
+        fout << std::endl;
+    }
+    fout.close();
 }
 
-// Convert color image data to grayscale matrix
-grayMatrix_t convertToGrayscaleMatrix(const vector<vector<PixelRGB>>& colorData) {
-    if (colorData.empty()) {
-        return grayMatrix_t();
+// Area-filter taps for shrinking `from` samples to `to`: output k averages the source
+// interval [k * from / to, (k + 1) * from / to), weights in 1/AREA_ONE that sum to
+// AREA_ONE. Weights are differences of the rounded cumulative coverage, so they never go
+// negative however many source samples one output spans.
+const int AREA_BITS = 16;
+const uint32_t AREA_ONE = 1u << AREA_BITS;
+
+struct AreaTaps {
+    vector<int> first;      // first source index per output sample
+    vector<int> offset;     // start of that sample's weights in `weight`
+    vector<uint32_t> weight;
+};
+
+static AreaTaps area_taps(int from, int to) {
+    AreaTaps taps;
+    for (int k = 0; k < to; k++) {
+        double begin = static_cast<double>(k) * from / to;
+        double end = static_cast<double>(k + 1) * from / to;
+        int first = static_cast<int>(begin);
+        int last = std::min(static_cast<int>(std::ceil(end)), from);
+        taps.first.push_back(first);
+        taps.offset.push_back(taps.weight.size());
+        uint32_t covered = 0;
+        for (int s = first; s < last; s++) {
+            uint32_t cumulative = AREA_ONE;
+            if (s < last - 1) {
+                double part = std::min<double>(s + 1, end) - begin;
+                cumulative = static_cast<uint32_t>(part / (end - begin) * AREA_ONE + 0.5);
+            }
+            taps.weight.push_back(cumulative - covered);
+            covered = cumulative;
+        }
     }
-    
-    int height = colorData.size();
-    int width = colorData[0].size();
-    grayMatrix_t grayMatrix(height, vector<uint8_t>(width));
-    
+    taps.offset.push_back(taps.weight.size());
+    return taps;
+}
+
+// Box/area downscale (exact box filter for integer factors), separable 16.16 fixed point.
+// row(y) returns input row y; rows are requested in non-decreasing order, so the
+// source can stream them.
+template<typename RowSource>
+static grayMatrix_t area_downscale_rows(int input_width, int input_height, int width, int height, RowSource row) {
+    AreaTaps columns = area_taps(input_width, width);
+    AreaTaps rows = area_taps(input_height, height);
+    grayMatrix_t result(width, height);
+    vector<uint32_t> horizontal(width);
+    vector<uint64_t> sum(width);
+
     for (int y = 0; y < height; y++) {
+        std::fill(sum.begin(), sum.end(), 0);
+        for (int t = rows.offset[y]; t < rows.offset[y + 1]; t++) {
+            const uint8_t* src = row(rows.first[y] + t - rows.offset[y]);
+            for (int x = 0; x < width; x++) {
+                uint32_t acc = 0;
+                const uint32_t* w = &columns.weight[columns.offset[x]];
+                const uint8_t* s = src + columns.first[x];
+                int n = columns.offset[x + 1] - columns.offset[x];
+                for (int k = 0; k < n; k++) {
+                    acc += w[k] * s[k];
+                }
+                horizontal[x] = acc;
+            }
+            uint64_t wy = rows.weight[t];
+            for (int x = 0; x < width; x++) {
+                sum[x] += wy * horizontal[x];
+            }
+        }
+        uint8_t* out = result[y];
         for (int x = 0; x < width; x++) {
-            grayMatrix[y][x] = rgbToGrayscale(colorData[y][x]);
+            out[x] = static_cast<uint8_t>((sum[x] + (1ull << (2 * AREA_BITS - 1))) >> (2 * AREA_BITS));
         }
     }
-    
-    return grayMatrix;
+    return result;
 }
 
-void save_matrix_to_file(const grayMatrix_t& matrix, const string& filename) {
-    std::ofstream fout(filename);
-    for (size_t i = 0; i < matrix.size(); i++) {
-        for (size_t j = 0; j < matrix[i].size(); j++) {
-            fout << (int)matrix[i][j] << " ";
-        }
-        fout << std::endl;
+grayMatrix_t area_downscale(const grayMatrix_t& input, int width, int height) {
+    if (input.empty() || width <= 0 || height <= 0) {
+        return grayMatrix_t();
     }
-    fout.close();
+    width = std::min(width, input.width());
+    height = std::min(height, input.height());
+    return area_downscale_rows(input.width(), input.height(), width, height,
+                               [&](int y) { return input[y]; });
 }
 
+// Size initialize() shrinks a width x height image to; false if it already fits
+static bool working_size(int width, int height, int& out_width, int& out_height) {
+    int long_side = std::max(width, height);
+    if (canny_max_side <= 0 || long_side <= canny_max_side) {
+        return false;
+    }
+    out_width = std::max(1, static_cast<int>(static_cast<long long>(width) * canny_max_side / long_side));
+    out_height = std::max(1, static_cast<int>(static_cast<long long>(height) * canny_max_side / long_side));
+    return true;
+}
+
+// Bytes of full-resolution rows decoded at a time when a large BMP is shrunk on read
+const size_t STREAM_BAND_BYTES = 16 << 20;
+
+// Out-of-core downscale: the BMP is decoded in bands of rows straight into the area
+// filter, and each band's mapped pages are dropped once the filter has moved past it.
+// Peak memory is one band plus the output, however large the source is.
+static grayMatrix_t downscale_bmp_streamed(const BMPGrayReader& reader, int width, int height) {
+    int input_width = reader.getWidth();
+    int input_height = reader.getHeight();
+    int band_rows = static_cast<int>(std::max<size_t>(STREAM_BAND_BYTES / input_width, 64));
+    band_rows = std::min(band_rows, input_height);
+    grayMatrix_t band(input_width, band_rows);
+    int band_begin = 0;
+    int band_end = 0;
+    grayMatrix_t result = area_downscale_rows(input_width, input_height, width, height, [&](int y) {
+        if (y >= band_end) {
+            reader.release(band_begin, band_end);
+            band_begin = y;
+            band_end = std::min(y + band_rows, input_height);
+            reader.readRows(band_begin, band_end, band);
+        }
+        return static_cast<const uint8_t*>(band[y - band_begin]);
+    });
+    reader.release(band_begin, band_end);
+    return result;
+}
+
+static bool prepare_gray();
+
 bool initialize(string inputFile) {
-    BMPImage img;
-    if (!img.readBMP(inputFile)) {
+    BMPGrayReader reader;
+    if (!reader.open(inputFile)) {
+        grayMatrix.clear();
         return 1;
     }
-        
-    if (img.isGrayscaleImage()) {
-        grayMatrix = img.toGrayscaleMatrix();
+
+    int width, height;
+    if (working_size(reader.getWidth(), reader.getHeight(), width, height)) {
+        // Never holds the full-resolution image, see downscale_bmp_streamed
+        grayMatrix = downscale_bmp_streamed(reader, width, height);
+        std::cout << "Downscaled to " << width << "x" << height << " for the output resolution" << std::endl;
     } else {
-        const auto& colorData = img.getColorData();
-        grayMatrix = convertToGrayscaleMatrix(colorData);
+        grayMatrix = grayMatrix_t(reader.getWidth(), reader.getHeight());
+        reader.readRows(0, reader.getHeight(), grayMatrix);
     }
-    
+    return prepare_gray();
+}
+
+bool initialize(const grayMatrix_t& frame) {
+    grayMatrix = frame;
+    return prepare_gray();
+}
+
+// Shared tail of both initialize() overloads: downscale and dump grayMatrix
+static bool prepare_gray() {
     if (grayMatrix.empty()) {
         return 1;
     }
+
+    // Detail finer than the output can show would only cost blur, NMS and tracing time
+    int width, height;
+    if (working_size(grayMatrix.width(), grayMatrix.height(), width, height)) {
+        grayMatrix = area_downscale(grayMatrix, width, height);
+        std::cout << "Downscaled to " << width << "x" << height << " for the output resolution" << std::endl;
+    }
     
     // Save matrix to text file
     // save_matrix_to_file(grayMatrix, "grayMatrix.txt");
-    img.fromGrayscaleMatrix(grayMatrix);
-    img.writeBMP("gray.bmp");
+    dump_image(DUMP_GRAY, grayMatrix, "gray.bmp");
 
-    std::cout << "image height: " << grayMatrix.size() << std::endl;
-    std::cout << "image width: " << grayMatrix[0].size() << std::endl;
+    std::cout << "image height: " << grayMatrix.height() << std::endl;
+    std::cout << "image width: " << grayMatrix.width() << std::endl;
     
     return 0;
 }
@@ -86,13 +216,13 @@ const kernel_t gauss_kernel_5 = {
 // 2D convolution function using standard convolution definition
 // Template function that accepts any input matrix type and kernel type, returns double matrix
 template<typename InputType, typename KernelType>
-matrix<double> convolution2d(const matrix<InputType>& input, const matrix<KernelType>& kernel) {
+Image<double> convolution2d(const Image<InputType>& input, const matrix<KernelType>& kernel) {
     if (input.empty() || kernel.empty()) {
-        return matrix<double>();
+        return Image<double>();
     }
     
-    int input_height = input.size();
-    int input_width = input[0].size();
+    int input_height = input.height();
+    int input_width = input.width();
     int kernel_height = kernel.size();
     int kernel_width = kernel[0].size();
     
@@ -102,13 +232,14 @@ matrix<double> convolution2d(const matrix<InputType>& input, const matrix<Kernel
     
     // Handle edge case where kernel is larger than input
     if (output_height <= 0 || output_width <= 0) {
-        return matrix<double>();
+        return Image<double>();
     }
     
-    matrix<double> result(output_height, vector<double>(output_width));
+    Image<double> result(output_width, output_height);
     
     // Standard 2D convolution using flipped kernel
     for (int i = 0; i < output_height; i++) {
+        double* out = result[i];
         for (int j = 0; j < output_width; j++) {
             double sum = 0.0;
             
@@ -122,29 +253,114 @@ matrix<double> convolution2d(const matrix<InputType>& input, const matrix<Kernel
                 }
             }
             
-            result[i][j] = sum;
+            out[j] = sum;
         }
     }
     
     return result;
 }
 
-// Simplified gaussian blur using convolution
+// Separable integer blur with binomial taps (1-2-1 or 1-4-6-4-1), valid region only.
+// Rows are pushed in order; horizontal sums are kept in a ring of `size` uint16 rows
+// and both passes fit in 16 bits.
+class BinomialBlurStream {
+private:
+    int size;
+    int shift;
+    int output_width;
+    int pushed;
+    Image<uint16_t> ring;
+
+public:
+    BinomialBlurStream(int input_width, int kernel_size)
+        : size(kernel_size == 5 ? 5 : 3), shift(kernel_size == 5 ? 8 : 4),
+          output_width(input_width - (kernel_size == 5 ? 5 : 3) + 1), pushed(0),
+          ring(std::max(output_width, 0), kernel_size == 5 ? 5 : 3) {}
+
+    int outputWidth() const { return output_width; }
+
+    // Feeds the next input row; returns true once `out` holds a blurred row
+    bool push(const uint8_t* __restrict src, uint8_t* __restrict out) {
+        uint16_t* __restrict dst = ring[pushed % size];
+        if (size == 3) {
+            for (int j = 0; j < output_width; j++) {
+                dst[j] = src[j] + 2 * src[j + 1] + src[j + 2];
+            }
+        } else {
+            for (int j = 0; j < output_width; j++) {
+                dst[j] = src[j] + 4 * (src[j + 1] + src[j + 3]) + 6 * src[j + 2] + src[j + 4];
+            }
+        }
+        pushed++;
+        if (pushed < size) {
+            return false;
+        }
+
+        int first = pushed - size;
+        if (size == 3) {
+            const uint16_t* a = ring[first % 3];
+            const uint16_t* b = ring[(first + 1) % 3];
+            const uint16_t* c = ring[(first + 2) % 3];
+            for (int j = 0; j < output_width; j++) {
+                out[j] = static_cast<uint8_t>((a[j] + 2 * b[j] + c[j]) >> shift);
+            }
+        } else {
+            const uint16_t* a = ring[first % 5];
+            const uint16_t* b = ring[(first + 1) % 5];
+            const uint16_t* c = ring[(first + 2) % 5];
+            const uint16_t* d = ring[(first + 3) % 5];
+            const uint16_t* e = ring[(first + 4) % 5];
+            for (int j = 0; j < output_width; j++) {
+                uint16_t sum = a[j] + 4 * (b[j] + d[j]) + 6 * c[j] + e[j];
+                out[j] = static_cast<uint8_t>(sum >> shift);
+            }
+        }
+        return true;
+    }
+};
+
+grayMatrix_t binomial_blur(const grayMatrix_t& input, int size) {
+    size = size == 5 ? 5 : 3;
+    int output_height = input.height() - size + 1;
+    int output_width = input.width() - size + 1;
+    if (input.empty() || output_height <= 0 || output_width <= 0) {
+        return grayMatrix_t();
+    }
+
+    grayMatrix_t result(output_width, output_height);
+    BinomialBlurStream stream(input.width(), size);
+    for (int y = 0; y < input.height(); y++) {
+        stream.push(input[y], result[std::max(y - size + 1, 0)]);
+    }
+
+    return result;
+}
+
+// Gaussian blur; the built-in kernels take the separable integer path
 grayMatrix_t gaussian_blur(const grayMatrix_t& input, const kernel_t& gaussian_kernel) {
+    if (gaussian_kernel == gauss_kernel_3) {
+        return binomial_blur(input, 3);
+    }
+    if (gaussian_kernel == gauss_kernel_5) {
+        return binomial_blur(input, 5);
+    }
+
     auto result_double = convolution2d(input, gaussian_kernel);
     
     if (result_double.empty()) {
         return grayMatrix_t();
     }
     
-    int height = result_double.size();
-    int width = result_double[0].size();
-    grayMatrix_t result(height, vector<uint8_t>(width));
+    int height = result_double.height();
+    int width = result_double.width();
+    grayMatrix_t result(width, height);
     
     // Convert double matrix back to uint8_t matrix with clamping
     for (int i = 0; i < height; i++) {
+        const double* src = result_double[i];
+        uint8_t* dst = result[i];
         for (int j = 0; j < width; j++) {
-            result[i][j] = static_cast<uint8_t>(std::max(0.0, std::min(255.0, result_double[i][j])));
+            dst[j] = static_cast<uint8_t>(std::max(0.0, std::min(255.0, src[j])));
         }
     }
     
@@ -172,24 +388,23 @@ const kernel_t prewitt_y_kernel = {
     { 1,  1,  1}
 };
 
-std::pair<realMatrix_t, realMatrix_t> filter(const grayMatrix_t& input, const kernel_t& x_kernel, const kernel_t& y_kernel) {
-    auto x = convolution2d(input, x_kernel);
-    auto y = convolution2d(input, y_kernel);
-
+// Magnitude and direction (degrees in [0, 180]) from the two gradient images
+template<typename T>
+static std::pair<realMatrix_t, realMatrix_t> gradient_polar(const Image<T>& x, const Image<T>& y) {
     if (x.empty() || y.empty()) {
         return std::make_pair(realMatrix_t(), realMatrix_t());
     }
 
-    size_t height = x.size();
-    size_t width = x[0].size();
+    int height = x.height();
+    int width = x.width();
     
-    realMatrix_t magnitude(height, vector<double>(width));
-    realMatrix_t direction(height, vector<double>(width));
+    realMatrix_t magnitude(width, height);
+    realMatrix_t direction(width, height);
     
-    for (size_t i = 0; i < height; i++) {
-        for (size_t j = 0; j < width; j++) {
-            double dx = x[i][j];  // Already double from convolution2d
-            double dy = y[i][j];  // Already double from convolution2d
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            double dx = x[i][j];
+            double dy = y[i][j];
             magnitude[i][j] = std::sqrt(dx * dx + dy * dy);
             direction[i][j] = std::atan2(dy, dx) * 180 / PI;
             if (direction[i][j] < 0) {
@@ -200,10 +415,184 @@ std::pair<realMatrix_t, realMatrix_t> filter(const grayMatrix_t& input, const ke
     return std::make_pair(magnitude, direction);
 }
 
+// Built-in Sobel/Prewitt pairs use the compile-time kernels; anything else falls back
+// to the runtime convolution2d
+std::pair<realMatrix_t, realMatrix_t> filter(const grayMatrix_t& input, const kernel_t& x_kernel, const kernel_t& y_kernel) {
+    if (x_kernel == sobel_x_kernel && y_kernel == sobel_y_kernel) {
+        return gradient_polar(convolve<SobelXKernel>(input), convolve<SobelYKernel>(input));
+    }
+    if (x_kernel == prewitt_x_kernel && y_kernel == prewitt_y_kernel) {
+        return gradient_polar(convolve<PrewittXKernel>(input), convolve<PrewittYKernel>(input));
+    }
+    return gradient_polar(convolution2d(input, x_kernel), convolution2d(input, y_kernel));
+}
+
+// tan(22.5 deg) ~= 5741 / 13860, both small enough for 16-bit multiply-add
+const int TAN_NUM = 5741;
+const int TAN_DEN = 13860;
+
+// Scalar Sobel for one pixel; same sign convention as convolution2d with sobel_x/y_kernel
+static inline void sobel_pixel(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int j, bool l1,
+                               uint16_t& magnitude, uint8_t& sector) {
+    int dx = (r0[j] - r0[j + 2]) + 2 * (r1[j] - r1[j + 2]) + (r2[j] - r2[j + 2]);
+    int dy = (r0[j] + 2 * r0[j + 1] + r0[j + 2]) - (r2[j] + 2 * r2[j + 1] + r2[j + 2]);
+    int ax = std::abs(dx), ay = std::abs(dy);
+
+    if (l1) {
+        magnitude = static_cast<uint16_t>(ax + ay);
+    } else {
+        magnitude = static_cast<uint16_t>(std::sqrt(static_cast<float>(dx * dx + dy * dy)) + 0.5f);
+    }
+
+    if (ay * TAN_DEN - ax * TAN_NUM <= 0) {
+        sector = SECTOR_HORIZONTAL;
+    } else if (ay * TAN_NUM - ax * TAN_DEN > 0) {
+        sector = SECTOR_VERTICAL;
+    } else {
+        sector = (dx ^ dy) >= 0 ? SECTOR_DIAGONAL : SECTOR_ANTI_DIAGONAL;
+    }
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#if defined(__AVX2__)
+typedef __m256i vec_t;
+const int VEC_PIXELS = 16;
+static inline vec_t load_u8(const uint8_t* p) { return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+static inline vec_t v_add16(vec_t a, vec_t b) { return _mm256_add_epi16(a, b); }
+static inline vec_t v_sub16(vec_t a, vec_t b) { return _mm256_sub_epi16(a, b); }
+static inline vec_t v_max16(vec_t a, vec_t b) { return _mm256_max_epi16(a, b); }
+static inline vec_t v_add32(vec_t a, vec_t b) { return _mm256_add_epi32(a, b); }
+static inline vec_t v_and(vec_t a, vec_t b) { return _mm256_and_si256(a, b); }
+static inline vec_t v_andnot(vec_t a, vec_t b) { return _mm256_andnot_si256(a, b); }
+static inline vec_t v_or(vec_t a, vec_t b) { return _mm256_or_si256(a, b); }
+static inline vec_t v_xor(vec_t a, vec_t b) { return _mm256_xor_si256(a, b); }
+static inline vec_t v_zero() { return _mm256_setzero_si256(); }
+static inline vec_t v_set16(int v) { return _mm256_set1_epi16(static_cast<short>(v)); }
+static inline vec_t v_set32(int v) { return _mm256_set1_epi32(v); }
+static inline vec_t v_pair16(int a, int b) { return _mm256_set1_epi32(static_cast<int>((static_cast<unsigned>(b) << 16) | (a & 0xFFFF))); }
+static inline vec_t v_unpacklo16(vec_t a, vec_t b) { return _mm256_unpacklo_epi16(a, b); }
+static inline vec_t v_unpackhi16(vec_t a, vec_t b) { return _mm256_unpackhi_epi16(a, b); }
+static inline vec_t v_madd16(vec_t a, vec_t b) { return _mm256_madd_epi16(a, b); }
+static inline vec_t v_cmpgt32(vec_t a, vec_t b) { return _mm256_cmpgt_epi32(a, b); }
+static inline vec_t v_cmplt32(vec_t a, vec_t b) { return _mm256_cmpgt_epi32(b, a); }
+static inline vec_t v_packs32(vec_t a, vec_t b) { return _mm256_packs_epi32(a, b); }
+static inline vec_t v_sqrt32(vec_t a) { return _mm256_cvtps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(a))); }
+static inline void store_u16(uint16_t* p, vec_t v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+static inline void store_u8(uint8_t* p, vec_t v) {
+    __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), packed);
+}
+#else
+typedef __m128i vec_t;
+const int VEC_PIXELS = 8;
+static inline vec_t load_u8(const uint8_t* p) { return _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), _mm_setzero_si128()); }
+static inline vec_t v_add16(vec_t a, vec_t b) { return _mm_add_epi16(a, b); }
+static inline vec_t v_sub16(vec_t a, vec_t b) { return _mm_sub_epi16(a, b); }
+static inline vec_t v_max16(vec_t a, vec_t b) { return _mm_max_epi16(a, b); }
+static inline vec_t v_add32(vec_t a, vec_t b) { return _mm_add_epi32(a, b); }
+static inline vec_t v_and(vec_t a, vec_t b) { return _mm_and_si128(a, b); }
+static inline vec_t v_andnot(vec_t a, vec_t b) { return _mm_andnot_si128(a, b); }
+static inline vec_t v_or(vec_t a, vec_t b) { return _mm_or_si128(a, b); }
+static inline vec_t v_xor(vec_t a, vec_t b) { return _mm_xor_si128(a, b); }
+static inline vec_t v_zero() { return _mm_setzero_si128(); }
+static inline vec_t v_set16(int v) { return _mm_set1_epi16(static_cast<short>(v)); }
+static inline vec_t v_set32(int v) { return _mm_set1_epi32(v); }
+static inline vec_t v_pair16(int a, int b) { return _mm_set1_epi32(static_cast<int>((static_cast<unsigned>(b) << 16) | (a & 0xFFFF))); }
+static inline vec_t v_unpacklo16(vec_t a, vec_t b) { return _mm_unpacklo_epi16(a, b); }
+static inline vec_t v_unpackhi16(vec_t a, vec_t b) { return _mm_unpackhi_epi16(a, b); }
+static inline vec_t v_madd16(vec_t a, vec_t b) { return _mm_madd_epi16(a, b); }
+static inline vec_t v_cmpgt32(vec_t a, vec_t b) { return _mm_cmpgt_epi32(a, b); }
+static inline vec_t v_cmplt32(vec_t a, vec_t b) { return _mm_cmplt_epi32(a, b); }
+static inline vec_t v_packs32(vec_t a, vec_t b) { return _mm_packs_epi32(a, b); }
+static inline vec_t v_sqrt32(vec_t a) { return _mm_cvtps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(a))); }
+static inline void store_u16(uint16_t* p, vec_t v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+static inline void store_u8(uint8_t* p, vec_t v) { _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(v, v)); }
+#endif
+
+// Sector for 32-bit lanes: (ay, ax) pairs interleaved, signs of dx ^ dy in `sign`
+static inline vec_t sobel_sector32(vec_t ayax, vec_t sign) {
+    vec_t horizontal = v_cmpgt32(v_set32(1), v_madd16(ayax, v_pair16(TAN_DEN, -TAN_NUM)));
+    vec_t vertical = v_cmpgt32(v_madd16(ayax, v_pair16(TAN_NUM, -TAN_DEN)), v_zero());
+    vec_t diagonal = v_or(v_and(v_cmplt32(sign, v_zero()), v_set32(SECTOR_ANTI_DIAGONAL)),
+                          v_andnot(v_cmplt32(sign, v_zero()), v_set32(SECTOR_DIAGONAL)));
+    vec_t sector = v_or(v_and(vertical, v_set32(SECTOR_VERTICAL)), v_andnot(vertical, diagonal));
+    return v_andnot(horizontal, sector);
+}
+
+// Vectorized Sobel over [0, count) of one output row; returns number of pixels done
+static int sobel_row_simd(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int count, bool l1,
+                          uint16_t* magnitude, uint8_t* sector) {
+    int j = 0;
+    // Loads read VEC_PIXELS bytes starting at j + 2, so keep them inside the row
+    for (; j + VEC_PIXELS + 2 <= count + 2; j += VEC_PIXELS) {
+        vec_t a0 = load_u8(r0 + j), a1 = load_u8(r0 + j + 1), a2 = load_u8(r0 + j + 2);
+        vec_t b0 = load_u8(r1 + j), b2 = load_u8(r1 + j + 2);
+        vec_t c0 = load_u8(r2 + j), c1 = load_u8(r2 + j + 1), c2 = load_u8(r2 + j + 2);
+
+        vec_t mid = v_sub16(b0, b2);
+        vec_t dx = v_add16(v_add16(v_sub16(a0, a2), v_sub16(c0, c2)), v_add16(mid, mid));
+        vec_t top = v_add16(v_add16(a0, a2), v_add16(a1, a1));
+        vec_t bottom = v_add16(v_add16(c0, c2), v_add16(c1, c1));
+        vec_t dy = v_sub16(top, bottom);
+
+        vec_t ax = v_max16(dx, v_sub16(v_zero(), dx));
+        vec_t ay = v_max16(dy, v_sub16(v_zero(), dy));
+
+        vec_t mag;
+        if (l1) {
+            mag = v_add16(ax, ay);
+        } else {
+            vec_t lo = v_unpacklo16(dx, dy), hi = v_unpackhi16(dx, dy);
+            mag = v_packs32(v_sqrt32(v_madd16(lo, lo)), v_sqrt32(v_madd16(hi, hi)));
+        }
+        store_u16(magnitude + j, mag);
+
+        // dx ^ dy is negative exactly when the signs differ; widen it with a zero partner
+        vec_t sign = v_xor(dx, dy);
+        vec_t sign_lo = v_unpacklo16(v_zero(), sign), sign_hi = v_unpackhi16(v_zero(), sign);
+        vec_t sec_lo = sobel_sector32(v_unpacklo16(ay, ax), sign_lo);
+        vec_t sec_hi = sobel_sector32(v_unpackhi16(ay, ax), sign_hi);
+        store_u8(sector + j, v_packs32(sec_lo, sec_hi));
+    }
+    return j;
+}
+#endif
+
+// One output row of Sobel from three consecutive input rows
+static void sobel_row(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int width, bool l1,
+                      uint16_t* mag, uint8_t* sec) {
+    int j = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    j = sobel_row_simd(r0, r1, r2, width, l1, mag, sec);
+#endif
+    for (; j < width; j++) {
+        sobel_pixel(r0, r1, r2, j, l1, mag[j], sec[j]);
+    }
+}
+
+// Sobel gradient on the valid region: 16-bit magnitude (L2, or L1 when l1 is set)
+// and the NMS sector picked by slope comparison instead of atan2
+void sobel_gradient(const grayMatrix_t& input, Image<uint16_t>& magnitude, Image<uint8_t>& sector, bool l1) {
+    int height = input.height() - 2;
+    int width = input.width() - 2;
+    if (input.empty() || height <= 0 || width <= 0) {
+        magnitude = Image<uint16_t>();
+        sector = Image<uint8_t>();
+        return;
+    }
+
+    magnitude = Image<uint16_t>(width, height);
+    sector = Image<uint8_t>(width, height);
+
+    for (int i = 0; i < height; i++) {
+        sobel_row(input[i], input[i + 1], input[i + 2], width, l1, magnitude[i], sector[i]);
+    }
+}
+
 realMatrix_t non_maximum_suppression(const realMatrix_t& magnitude, const realMatrix_t& direction) {
-    int height = magnitude.size();
-    int width = magnitude[0].size();
-    realMatrix_t result(height, vector<double>(width));
+    int height = magnitude.height();
+    int width = magnitude.width();
+    realMatrix_t result(width, height);
 
     for (int i = 1; i < height - 1; i++) {
         for (int j = 1; j < width - 1; j++) {
@@ -232,86 +621,504 @@ realMatrix_t non_maximum_suppression(const realMatrix_t& magnitude, const realMa
     return result;
 }
 
-grayMatrix_t double_threshold(const realMatrix_t& input, double low_threshold, double high_threshold) {
-    int height = input.size();
-    int width = input[0].size();
-    grayMatrix_t result(height, vector<uint8_t>(width));
+// NMS for one interior row; the first and last columns are left at zero.
+// Neighbour pairs (q, r) per sector match the angle-based version.
+static void nms_row(const uint16_t* prev, const uint16_t* cur, const uint16_t* next, const uint8_t* sec,
+                    int width, uint16_t* __restrict out) {
+    out[0] = 0;
+    // All candidates are loaded unconditionally so the selects vectorize
+    for (int j = 1; j < width - 1; j++) {
+        uint16_t m = cur[j];
+        uint8_t s = sec[j];
+        uint16_t h_q = cur[j + 1], h_r = cur[j - 1];
+        uint16_t d_q = next[j - 1], d_r = prev[j + 1];
+        uint16_t v_q = next[j], v_r = prev[j];
+        uint16_t a_q = prev[j - 1], a_r = next[j + 1];
+        uint16_t q = s == SECTOR_HORIZONTAL ? h_q : s == SECTOR_DIAGONAL ? d_q : s == SECTOR_VERTICAL ? v_q : a_q;
+        uint16_t r = s == SECTOR_HORIZONTAL ? h_r : s == SECTOR_DIAGONAL ? d_r : s == SECTOR_VERTICAL ? v_r : a_r;
+        out[j] = (m >= q && m >= r) ? m : 0;
+    }
+    if (width > 1) {
+        out[width - 1] = 0;
+    }
+}
+
+Image<uint16_t> non_maximum_suppression(const Image<uint16_t>& magnitude, const Image<uint8_t>& sector) {
+    int height = magnitude.height();
+    int width = magnitude.width();
+    Image<uint16_t> result(width, height, 0);
+
+    for (int i = 1; i < height - 1; i++) {
+        nms_row(magnitude[i - 1], magnitude[i], magnitude[i + 1], sector[i], width, result[i]);
+    }
+
+    return result;
+}
+
+// Strong (255) / weak (128) / none (0) classification of one row with absolute thresholds
+template<typename T>
+static void classify_row(const T* in, int width, double low_threshold, double high_threshold, uint8_t* out) {
+    for (int j = 0; j < width; j++) {
+        if (in[j] >= high_threshold) {
+            out[j] = 255;
+        } else if (in[j] >= low_threshold) {
+            out[j] = 128;
+        } else {
+            out[j] = 0;
+        }
+    }
+}
+
+// Integer magnitudes compare against the rounded-up thresholds, which vectorizes
+static void classify_row(const uint16_t* in, int width, double low_threshold, double high_threshold, uint8_t* __restrict out) {
+    int low = static_cast<int>(std::ceil(low_threshold));
+    int high = static_cast<int>(std::ceil(high_threshold));
+    for (int j = 0; j < width; j++) {
+        out[j] = in[j] >= high ? 255 : in[j] >= low ? 128 : 0;
+    }
+}
+
+// Shared by the double and 16-bit magnitude paths
+template<typename T>
+static grayMatrix_t double_threshold_impl(const Image<T>& input, double low_threshold, double high_threshold) {
+    int height = input.height();
+    int width = input.width();
+    grayMatrix_t result(width, height);
 
     double max_value = 0;
     double min_value = 255;
     for (int i = 0; i < height; i++) {
         for (int j = 0; j < width; j++) {
-            max_value = std::max(max_value, input[i][j]);
-            min_value = std::min(min_value, input[i][j]);
+            max_value = std::max(max_value, static_cast<double>(input[i][j]));
+            min_value = std::min(min_value, static_cast<double>(input[i][j]));
         }
     }
     low_threshold = min_value + (max_value - min_value) * low_threshold;
     high_threshold = min_value + (max_value - min_value) * high_threshold;
 
+    for (int i = 0; i < height; i++) {
+        classify_row(input[i], width, low_threshold, high_threshold, result[i]);
+    }
+
+    hysteresis(result);
+    return result;
+}
+
+// Hysteresis: every weak (128) pixel 8-connected to a strong (255) one through other
+// weak pixels becomes strong, the rest are dropped. Flood fill with an explicit stack;
+// each pixel is pushed at most twice, so this is O(pixels) and independent of scan order.
+void hysteresis(grayMatrix_t& result) {
+    int height = result.height();
+    int width = result.width();
+    vector<std::pair<int, int>> stack;
+
     for (int i = 0; i < height; i++) {
         for (int j = 0; j < width; j++) {
-            if (input[i][j] >= high_threshold) {
-                result[i][j] = 255;
-            } else if (input[i][j] >= low_threshold) {
-                result[i][j] = 128;
-            } else {
-                result[i][j] = 0;
+            if (result[i][j] != 255) {
+                continue;
+            }
+            stack.push_back(std::make_pair(i, j));
+            while (!stack.empty()) {
+                int x = stack.back().first;
+                int y = stack.back().second;
+                stack.pop_back();
+                int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, height - 1);
+                int y0 = std::max(y - 1, 0), y1 = std::min(y + 1, width - 1);
+                for (int nx = x0; nx <= x1; nx++) {
+                    uint8_t* row = result[nx];
+                    for (int ny = y0; ny <= y1; ny++) {
+                        if (row[ny] == 128) {
+                            row[ny] = 255;
+                            stack.push_back(std::make_pair(nx, ny));
+                        }
+                    }
+                }
             }
         }
     }
 
-    for (int i = 1; i < height - 1; i++) {
-        for (int j = 1; j < width - 1; j++) {
-            if (result[i][j] == 128) {
-                if (result[i - 1][j - 1] == 255 || result[i - 1][j] == 255 || result[i - 1][j + 1] == 255 || result[i][j - 1] == 255 || result[i][j + 1] == 255 || result[i + 1][j - 1] == 255 || result[i + 1][j] == 255 || result[i + 1][j + 1] == 255) {
-                    result[i][j] = 255;
-                } else {
-                    result[i][j] = 0;
-                }
-            }
+    for (int i = 0; i < height; i++) {
+        uint8_t* row = result[i];
+        for (int j = 0; j < width; j++) {
+            row[j] = row[j] == 255 ? 255 : 0;
         }
     }
+}
+
+grayMatrix_t double_threshold(const realMatrix_t& input, double low_threshold, double high_threshold) {
+    return double_threshold_impl(input, low_threshold, high_threshold);
+}
+
+grayMatrix_t double_threshold(const Image<uint16_t>& input, double low_threshold, double high_threshold) {
+    return double_threshold_impl(input, low_threshold, high_threshold);
+}
 
+// Streams blur -> Sobel -> NMS through 3-row rings and hands rows [begin, end) of the
+// suppressed magnitude to sink(row_index, row); the image border rows come out as zeros.
+// Suppressed row t reads input rows t - 1 .. t + 5, so a band only pulls in that halo.
+template<typename Sink>
+static void stream_suppressed(const grayMatrix_t& input, int begin, int end, Sink sink) {
+    BinomialBlurStream blur(input.width(), 3);
+    int blur_width = blur.outputWidth();
+    int width = blur_width - 2;
+    int height = input.height() - 4;
+    if (input.empty() || width <= 0 || height <= 0) {
+        return;
+    }
+    begin = std::max(begin, 0);
+    end = std::min(end, height);
+
+    grayMatrix_t blurred(blur_width, 3);
+    Image<uint16_t> magnitude(width, 3);
+    Image<uint8_t> sector(width, 3);
+    Image<uint16_t> suppressed(width, 1, 0);
+    Image<uint16_t> zero_row(width, 1, 0);
+
+    if (begin == 0 && end > 0) {
+        sink(0, zero_row[0]);
+    }
+
+    // Ring slots are indexed by global row number
+    int first = std::max(begin - 1, 0);
+    int last = std::min(end + 5, input.height());
+    int blurred_rows = 0;
+    for (int y = first; y < last; y++) {
+        int b = first + blurred_rows;
+        if (!blur.push(input[y], blurred[b % 3])) {
+            continue;
+        }
+        blurred_rows++;
+        if (blurred_rows < 3) {
+            continue;
+        }
+
+        int s = b - 2;
+        sobel_row(blurred[s % 3], blurred[(s + 1) % 3], blurred[(s + 2) % 3], width, false,
+                  magnitude[s % 3], sector[s % 3]);
+        int t = s - 1;
+        if (t >= std::max(begin, 1) && t < std::min(end, height - 1) && s - 2 >= first) {
+            nms_row(magnitude[(t - 1) % 3], magnitude[t % 3], magnitude[(t + 1) % 3], sector[t % 3],
+                    width, suppressed[0]);
+            sink(t, suppressed[0]);
+        }
+    }
+
+    if (end == height && height >= 2 && begin < height) {
+        sink(height - 1, zero_row[0]);
+    }
+}
+
+// Minimum rows per band; thinner bands spend more time on halo rows than on output
+const int CANNY_MIN_BAND = 64;
+
+// Fused Canny: the only full-size buffer is the returned edge map.
+// The suppressed magnitude is streamed twice, once for the min/max that the relative
+// thresholds need and once to classify, which is cheaper than keeping it around.
+// Both passes run over horizontal bands on canny_threads workers; hysteresis then
+// runs once over the whole map so chains cross band borders as before.
+grayMatrix_t canny_fused(const grayMatrix_t& input, double low_threshold, double high_threshold) {
+    int height = input.height() - 4;
+    int width = input.width() - 4;
+    if (input.empty() || height <= 0 || width <= 0) {
+        return grayMatrix_t();
+    }
+
+    int bands = band_count(height, canny_threads, CANNY_MIN_BAND);
+    vector<uint16_t> band_max(bands, 0);
+    vector<uint16_t> band_min(bands, 255);
+    parallel_bands(height, canny_threads, CANNY_MIN_BAND, [&](int band, int begin, int end) {
+        uint16_t max_value = 0;
+        uint16_t min_value = 255;
+        stream_suppressed(input, begin, end, [&](int, const uint16_t* row) {
+            for (int j = 0; j < width; j++) {
+                max_value = std::max(max_value, row[j]);
+                min_value = std::min(min_value, row[j]);
+            }
+        });
+        band_max[band] = max_value;
+        band_min[band] = min_value;
+    });
+    uint16_t max_value = *std::max_element(band_max.begin(), band_max.end());
+    uint16_t min_value = *std::min_element(band_min.begin(), band_min.end());
+    low_threshold = min_value + (max_value - min_value) * low_threshold;
+    high_threshold = min_value + (max_value - min_value) * high_threshold;
+
+    grayMatrix_t result(width, height);
+    parallel_bands(height, canny_threads, CANNY_MIN_BAND, [&](int, int begin, int end) {
+        stream_suppressed(input, begin, end, [&](int i, const uint16_t* row) {
+            classify_row(row, width, low_threshold, high_threshold, result[i]);
+        });
+    });
+
+    hysteresis(result);
     return result;
 }
 
-bool single_color() {
-    int height = grayMatrix.size();
-    int width = grayMatrix[0].size();
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            if (grayMatrix[i][j] != grayMatrix[0][0]) {
-                return false;
+// Min and max magnitude present in the histogram
+static void histogram_range(SuppressedCache& cache) {
+    cache.min_value = 255;
+    cache.max_value = 0;
+    for (int v = 0; v < MAGNITUDE_LEVELS; v++) {
+        if (cache.histogram[v] > 0) {
+            cache.min_value = std::min<int>(cache.min_value, v);
+            cache.max_value = std::max<int>(cache.max_value, v);
+        }
+    }
+}
+
+SuppressedCache suppressed_magnitude(const grayMatrix_t& input) {
+    SuppressedCache cache;
+    cache.histogram.assign(MAGNITUDE_LEVELS, 0);
+    cache.min_value = 255;
+    cache.max_value = 0;
+    int height = input.height() - 4;
+    int width = input.width() - 4;
+    if (input.empty() || height <= 0 || width <= 0) {
+        return cache;
+    }
+
+    cache.magnitude = Image<uint16_t>(width, height);
+    int bands = band_count(height, canny_threads, CANNY_MIN_BAND);
+    vector<vector<int>> band_histogram(bands, vector<int>(MAGNITUDE_LEVELS, 0));
+    parallel_bands(height, canny_threads, CANNY_MIN_BAND, [&](int band, int begin, int end) {
+        vector<int>& histogram = band_histogram[band];
+        stream_suppressed(input, begin, end, [&](int i, const uint16_t* row) {
+            std::copy(row, row + width, cache.magnitude[i]);
+            for (int j = 0; j < width; j++) {
+                histogram[row[j]]++;
             }
+        });
+    });
+
+    for (int b = 0; b < bands; b++) {
+        for (int v = 0; v < MAGNITUDE_LEVELS; v++) {
+            cache.histogram[v] += band_histogram[b][v];
         }
     }
-    return true;
+    histogram_range(cache);
+    return cache;
 }
 
-void canny(string srcFile, double highThreshold, double lowThreshold) {
-    initialize(srcFile);
+// Recomputes one rectangle of the suppressed magnitude from a crop of the input that
+// covers its halo (input rows top - 2 .. bottom + 5, same for columns). The crop's own
+// zeroed border only lands outside the rectangle or on the image border, which is zero
+// anyway. delta receives -1 per old value and +1 per new value.
+static void update_region(Image<uint16_t>& magnitude, const grayMatrix_t& input, const TileRect& region,
+                          vector<int>& delta) {
+    int top = std::max(region.top - 2, 0);
+    int bottom = std::min(region.bottom + 6, input.height());
+    int left = std::max(region.left - 2, 0);
+    int right = std::min(region.right + 6, input.width());
+
+    grayMatrix_t crop(right - left, bottom - top);
+    for (int y = top; y < bottom; y++) {
+        std::copy(input[y] + left, input[y] + right, crop[y - top]);
+    }
+
+    int count = region.right - region.left;
+    stream_suppressed(crop, region.top - top, region.bottom - top, [&](int i, const uint16_t* row) {
+        uint16_t* dst = magnitude[i + top] + region.left;
+        const uint16_t* src = row + (region.left - left);
+        for (int j = 0; j < count; j++) {
+            delta[dst[j]]--;
+            delta[src[j]]++;
+            dst[j] = src[j];
+        }
+    });
+}
 
-    if (single_color()) {
-        grayMatrix_t result(grayMatrix.size(), vector<uint8_t>(grayMatrix[0].size(), 0));
-        result[0][0] = 255;
-        grayMatrix = result;
+void update_suppressed(SuppressedCache& cache, const grayMatrix_t& input, const vector<TileRect>& regions) {
+    if (regions.empty() || cache.magnitude.empty()) {
         return;
-    } else {
-        grayMatrix = gaussian_blur(grayMatrix, gauss_kernel_3);
+    }
+
+    int count = static_cast<int>(regions.size());
+    int bands = band_count(count, canny_threads, 1);
+    vector<vector<int>> band_delta(bands, vector<int>(MAGNITUDE_LEVELS, 0));
+    parallel_bands(count, canny_threads, 1, [&](int band, int begin, int end) {
+        for (int r = begin; r < end; r++) {
+            update_region(cache.magnitude, input, regions[r], band_delta[band]);
+        }
+    });
+
+    for (int b = 0; b < bands; b++) {
+        for (int v = 0; v < MAGNITUDE_LEVELS; v++) {
+            cache.histogram[v] += band_delta[b][v];
+        }
+    }
+    histogram_range(cache);
+}
+
+// Classifies the cached magnitude with absolute thresholds and runs hysteresis
+static grayMatrix_t threshold_cached_absolute(const SuppressedCache& cache, double low_threshold, double high_threshold) {
+    const Image<uint16_t>& magnitude = cache.magnitude;
+    grayMatrix_t result(magnitude.width(), magnitude.height());
+    parallel_bands(magnitude.height(), canny_threads, CANNY_MIN_BAND, [&](int, int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            classify_row(magnitude[i], magnitude.width(), low_threshold, high_threshold, result[i]);
+        }
+    });
+    hysteresis(result);
+    return result;
+}
+
+grayMatrix_t threshold_cached(const SuppressedCache& cache, double low_threshold, double high_threshold) {
+    double range = cache.max_value - cache.min_value;
+    return threshold_cached_absolute(cache, cache.min_value + range * low_threshold,
+                                     cache.min_value + range * high_threshold);
+}
+
+grayMatrix_t threshold_cached_levels(const SuppressedCache& cache, int low_level, int high_level) {
+    return threshold_cached_absolute(cache, low_level, high_level);
+}
+
+grayMatrix_t classify_cached(const SuppressedCache& cache, double low_threshold, double high_threshold) {
+    const Image<uint16_t>& magnitude = cache.magnitude;
+    double range = cache.max_value - cache.min_value;
+    double low = cache.min_value + range * low_threshold;
+    double high = cache.min_value + range * high_threshold;
+    grayMatrix_t result(magnitude.width(), magnitude.height());
+    parallel_bands(magnitude.height(), canny_threads, CANNY_MIN_BAND, [&](int, int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            classify_row(magnitude[i], magnitude.width(), low, high, result[i]);
+        }
+    });
+    return result;
+}
+
+// A component whose status can change has a pixel inside a rectangle or right next to
+// one, so the flood starts from the rectangles grown by one pixel. Components that
+// never reach them keep their old pixels in `edges`.
+void threshold_cached_update(const SuppressedCache& cache, double low_threshold, double high_threshold,
+                             const vector<TileRect>& regions, grayMatrix_t& classes, grayMatrix_t& edges) {
+    const Image<uint16_t>& magnitude = cache.magnitude;
+    int height = magnitude.height();
+    int width = magnitude.width();
+    double range = cache.max_value - cache.min_value;
+    double low = cache.min_value + range * low_threshold;
+    double high = cache.min_value + range * high_threshold;
+    for (size_t r = 0; r < regions.size(); r++) {
+        const TileRect& rect = regions[r];
+        for (int i = rect.top; i < rect.bottom; i++) {
+            classify_row(magnitude[i] + rect.left, rect.right - rect.left, low, high, classes[i] + rect.left);
+        }
+    }
+
+    Image<uint8_t> seen(width, height, 0);
+    vector<std::pair<int, int>> stack;
+    vector<std::pair<int, int>> component;
+    for (size_t r = 0; r < regions.size(); r++) {
+        const TileRect& rect = regions[r];
+        int top = std::max(rect.top - 1, 0), bottom = std::min(rect.bottom + 1, height);
+        int left = std::max(rect.left - 1, 0), right = std::min(rect.right + 1, width);
+        for (int i = top; i < bottom; i++) {
+            for (int j = left; j < right; j++) {
+                if (seen[i][j]) {
+                    continue;
+                }
+                seen[i][j] = 1;
+                if (classes[i][j] == 0) {
+                    edges[i][j] = 0;
+                    continue;
+                }
 
-        std::pair<realMatrix_t, realMatrix_t> result = filter(grayMatrix, sobel_x_kernel, sobel_y_kernel);
-        realMatrix_t magnitude = result.first;
-        realMatrix_t direction = result.second;
+                bool strong = false;
+                component.clear();
+                stack.push_back(std::make_pair(i, j));
+                while (!stack.empty()) {
+                    int x = stack.back().first;
+                    int y = stack.back().second;
+                    stack.pop_back();
+                    component.push_back(std::make_pair(x, y));
+                    strong = strong || classes[x][y] == 255;
+                    int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, height - 1);
+                    int y0 = std::max(y - 1, 0), y1 = std::min(y + 1, width - 1);
+                    for (int nx = x0; nx <= x1; nx++) {
+                        for (int ny = y0; ny <= y1; ny++) {
+                            if (!seen[nx][ny] && classes[nx][ny] != 0) {
+                                seen[nx][ny] = 1;
+                                stack.push_back(std::make_pair(nx, ny));
+                            }
+                        }
+                    }
+                }
+                uint8_t value = strong ? 255 : 0;
+                for (size_t k = 0; k < component.size(); k++) {
+                    edges[component[k].first][component[k].second] = value;
+                }
+            }
+        }
+    }
+}
 
-        realMatrix_t suppressed = non_maximum_suppression(magnitude, direction);
+static int count_edge_pixels(const grayMatrix_t& edges) {
+    int count = 0;
+    for (int i = 0; i < edges.height(); i++) {
+        const uint8_t* row = edges[i];
+        for (int j = 0; j < edges.width(); j++) {
+            count += row[j] == 255;
+        }
+    }
+    return count;
+}
 
-        grayMatrix_t double_threshold_result = double_threshold(suppressed, lowThreshold, highThreshold);
-        grayMatrix = double_threshold_result;
+// Binary search over the integer high threshold H (low = ceil(low_ratio * H)); the edge
+// count never grows with H. The histogram brackets each probe first: pixels >= H are
+// always kept and pixels >= low are the most that can be, so only undecided
+// midpoints pay for classification + hysteresis.
+grayMatrix_t canny_target_points(const SuppressedCache& cache, int target_points, double low_ratio,
+                                 int& high_level, int& low_level) {
+    int levels = cache.max_value + 2;
+    vector<int> at_least(levels + 1, 0);   // at_least[v] = pixels with magnitude >= v
+    for (int v = levels - 1; v >= 0; v--) {
+        at_least[v] = at_least[v + 1] + (v < MAGNITUDE_LEVELS ? cache.histogram[v] : 0);
     }
+    auto low_of = [&](int high) {
+        return std::max(1, static_cast<int>(std::ceil(low_ratio * high)));
+    };
 
-    // Save as BMP file
-    BMPImage outputImg;
-    outputImg.fromGrayscaleMatrix(grayMatrix);
-    outputImg.writeBMP("canny.bmp");
-    std::cout << "Result canny.bmp saved." << std::endl;
+    // Smallest H whose edge count fits the budget; H = max + 1 keeps nothing
+    int lo = 1, hi = cache.max_value + 1;
+    int probes = 0;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        bool fits;
+        if (at_least[low_of(mid)] <= target_points) {
+            fits = true;
+        } else if (at_least[mid] > target_points) {
+            fits = false;
+        } else {
+            fits = count_edge_pixels(threshold_cached_levels(cache, low_of(mid), mid)) <= target_points;
+            probes++;
+        }
+        if (fits) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    high_level = lo;
+    low_level = low_of(lo);
+    double range = std::max(1, cache.max_value - cache.min_value);
+    std::cout << "Auto threshold: high " << (high_level - cache.min_value) / range
+              << ", low " << (low_level - cache.min_value) / range
+              << " (levels " << high_level << " / " << low_level << ", " << probes << " probes)" << std::endl;
+    return threshold_cached_levels(cache, low_level, high_level);
+}
+
+bool single_color() {
+    if (grayMatrix.empty()) {
+        return false;
+    }
+    int height = grayMatrix.height();
+    int width = grayMatrix.width();
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            if (grayMatrix[i][j] != grayMatrix[0][0]) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
@@ -4,37 +4,99 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include "image.h"
 
 using std::vector;
 using std::string;
 
+// Nested vectors are only used for small runtime tables (kernels, component graphs)
 template<typename T>
 using matrix = vector<vector<T>>;
 
-using grayMatrix_t = matrix<uint8_t>;
+using grayMatrix_t = Image<uint8_t>;
 using kernel_t = matrix<double>;
-using realMatrix_t = matrix<double>;
+using realMatrix_t = Image<double>;
 
-// External global variable
+// Gradient direction sectors used by non-maximum suppression
+enum GradientSector : uint8_t {
+    SECTOR_HORIZONTAL = 0,     // [0, 22.5) or [157.5, 180] degrees
+    SECTOR_DIAGONAL = 1,       // [22.5, 67.5)
+    SECTOR_VERTICAL = 2,       // [67.5, 112.5)
+    SECTOR_ANTI_DIAGONAL = 3   // [112.5, 157.5)
+};
+
+// External global variables
 extern grayMatrix_t grayMatrix;
+extern int canny_threads;   // worker threads for canny_fused; 0 = one per hardware thread
+extern int canny_max_side;  // initialize() shrinks longer images to this side; 0 = off
 
 // Function declarations
-uint8_t rgbToGrayscale(const struct PixelRGB& pixel);
-grayMatrix_t convertToGrayscaleMatrix(const vector<vector<struct PixelRGB>>& colorData);
 void save_matrix_to_file(const grayMatrix_t& matrix, const string& filename);
 bool initialize(string inputFile);
+bool initialize(const grayMatrix_t& frame);   // already decoded frame, e.g. from a GIF
+grayMatrix_t area_downscale(const grayMatrix_t& input, int width, int height);
 
 // Convolution and filtering functions
 template<typename InputType, typename KernelType>
-matrix<double> convolution2d(const matrix<InputType>& input, const matrix<KernelType>& kernel);
+Image<double> convolution2d(const Image<InputType>& input, const matrix<KernelType>& kernel);
 
 grayMatrix_t gaussian_blur(const grayMatrix_t& input, const kernel_t& gaussian_kernel);
+grayMatrix_t binomial_blur(const grayMatrix_t& input, int size);
 std::pair<realMatrix_t, realMatrix_t> filter(const grayMatrix_t& input, const kernel_t& x_kernel, const kernel_t& y_kernel);
 realMatrix_t non_maximum_suppression(const realMatrix_t& magnitude, const realMatrix_t& direction);
 grayMatrix_t double_threshold(const realMatrix_t& input, double low_threshold, double high_threshold);
 
-// Main Canny function
-void canny(string srcFile, double highThreshold = 0.02, double lowThreshold = 0.01);
+// Integer Sobel path (SSE2/AVX2 when available)
+void sobel_gradient(const grayMatrix_t& input, Image<uint16_t>& magnitude, Image<uint8_t>& sector, bool l1 = false);
+Image<uint16_t> non_maximum_suppression(const Image<uint16_t>& magnitude, const Image<uint8_t>& sector);
+grayMatrix_t double_threshold(const Image<uint16_t>& input, double low_threshold, double high_threshold);
+void hysteresis(grayMatrix_t& result);
+
+// Streaming blur (3x3) -> Sobel -> NMS -> threshold with rolling line buffers
+grayMatrix_t canny_fused(const grayMatrix_t& input, double low_threshold, double high_threshold);
+
+// Suppressed gradient magnitude kept around for repeated thresholding
+const int MAGNITUDE_LEVELS = 2048;   // Sobel magnitudes stay below 2048 (L1 max is 2040)
+struct SuppressedCache {
+    Image<uint16_t> magnitude;
+    vector<int> histogram;           // histogram[v] = pixels with magnitude v
+    int min_value;
+    int max_value;
+};
+SuppressedCache suppressed_magnitude(const grayMatrix_t& input);
+
+// Half-open rectangle [top, bottom) x [left, right) in suppressed-magnitude coordinates
+struct TileRect {
+    int top, left, bottom, right;
+};
+
+// Recomputes the cached magnitude inside each rectangle from a changed input of the same
+// size; rectangles must not overlap. Histogram, min and max are kept in step.
+void update_suppressed(SuppressedCache& cache, const grayMatrix_t& input, const vector<TileRect>& regions);
+void threshold_cached_update(const SuppressedCache& cache, double low_threshold, double high_threshold,
+                             const vector<TileRect>& regions, grayMatrix_t& classes, grayMatrix_t& edges);
+grayMatrix_t threshold_cached(const SuppressedCache& cache, double low_threshold, double high_threshold);
+
+// Same with absolute magnitude levels: strong at >= high_level, weak at >= low_level.
+// Integer levels skip the relative <-> absolute conversion, so the levels reported by
+// canny_target_points rebuild exactly the map it returned.
+grayMatrix_t threshold_cached_levels(const SuppressedCache& cache, int low_level, int high_level);
+
+// threshold_cached split in two for incremental use: classify_cached returns the strong
+// (255) / weak (128) map before hysteresis; threshold_cached_update reclassifies the given
+// rectangles of it and redoes hysteresis only for the weak/strong components that touch
+// them, updating edges in place. Both take relative thresholds.
+grayMatrix_t classify_cached(const SuppressedCache& cache, double low_threshold, double high_threshold);
+
+// Searches thresholds (low = low_ratio * high) for the largest edge map with at most
+// target_points pixels; the chosen magnitude levels are written back (see
+// threshold_cached_levels)
+const double AUTO_LOW_RATIO = 0.5;
+grayMatrix_t canny_target_points(const SuppressedCache& cache, int target_points, double low_ratio,
+                                 int& high_level, int& low_level);
+
+// True when every pixel of grayMatrix has the same value; false for an empty image
+bool single_color();
 
 // Kernels
 extern const kernel_t gauss_kernel_3;
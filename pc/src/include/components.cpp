@@ -0,0 +1,208 @@
+#include "components.h"
+#include "parallel.h"
+#include <bits/stdc++.h>
+
+int prune_min_pixels = 0;
+int prune_min_area = 0;
+
+void configure_pruning() {
+    const char* spec = std::getenv("OSCILLO_PRUNE");
+    if (spec == nullptr) {
+        return;
+    }
+    int pixels = 0, area = 0;
+    char extra;
+    int fields = std::sscanf(spec, "%d,%d%c", &pixels, &area, &extra);
+    if (fields < 1 || fields > 2 || pixels < 0 || area < 0) {
+        std::cerr << "Warning: bad OSCILLO_PRUNE value '" << spec << "'" << std::endl;
+        return;
+    }
+    prune_min_pixels = pixels;
+    prune_min_area = area;
+}
+
+static int find_root(vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+// The smaller root wins, so every provisional label resolves to the label of its
+// component's first pixel in raster order
+static void unite(vector<int>& parent, int a, int b) {
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+// Minimum rows per labelling band
+const int LABEL_MIN_BAND = 64;
+
+// Pass 1 over rows [begin, end): provisional labels from the already visited
+// neighbours (W, NW, N, NE) inside the band; the band's first row does not look up
+static void label_band(const grayMatrix_t& edges, Image<int>& labels, int begin, int end, vector<int>& parent) {
+    int width = edges.width();
+    for (int i = begin; i < end; i++) {
+        const uint8_t* row = edges[i];
+        int* label = labels[i];
+        const int* above = i > begin ? labels[i - 1] : nullptr;
+        for (int j = 0; j < width; j++) {
+            if (row[j] != 255) {
+                continue;
+            }
+            int current = -1;
+            int neighbours[4] = {
+                j > 0 ? label[j - 1] : -1,
+                above && j > 0 ? above[j - 1] : -1,
+                above ? above[j] : -1,
+                above && j + 1 < width ? above[j + 1] : -1
+            };
+            for (int k = 0; k < 4; k++) {
+                if (neighbours[k] < 0) {
+                    continue;
+                }
+                if (current < 0) {
+                    current = neighbours[k];
+                } else if (neighbours[k] != current) {
+                    unite(parent, current, neighbours[k]);
+                }
+            }
+            if (current < 0) {
+                current = static_cast<int>(parent.size());
+                parent.push_back(current);
+            }
+            label[j] = current;
+        }
+    }
+}
+
+// Bands of rows are labelled in parallel with their own provisional labels, which are
+// then shifted into one union-find forest; components crossing a seam are merged by
+// uniting each seam row with the row above it.
+vector<Component> label_components(const grayMatrix_t& edges, Image<int>& labels) {
+    int height = edges.height();
+    int width = edges.width();
+    labels = Image<int>(width, height, -1);
+
+    int bands = band_count(height, canny_threads, LABEL_MIN_BAND);
+    vector<vector<int>> band_parent(bands);
+    vector<int> band_begin(bands + 1, height);
+    parallel_bands(height, canny_threads, LABEL_MIN_BAND, [&](int band, int begin, int end) {
+        band_begin[band] = begin;
+        label_band(edges, labels, begin, end, band_parent[band]);
+    });
+
+    vector<int> parent;
+    for (int b = 0; b < bands; b++) {
+        int offset = static_cast<int>(parent.size());
+        for (int p : band_parent[b]) {
+            parent.push_back(p + offset);
+        }
+        if (offset == 0) {
+            continue;
+        }
+        for (int i = band_begin[b]; i < band_begin[b + 1]; i++) {
+            int* label = labels[i];
+            for (int j = 0; j < width; j++) {
+                if (label[j] >= 0) {
+                    label[j] += offset;
+                }
+            }
+        }
+    }
+
+    // Seams: 8-connectivity between each band's first row and the row above it
+    for (int b = 1; b < bands; b++) {
+        int i = band_begin[b];
+        const int* label = labels[i];
+        const int* above = labels[i - 1];
+        for (int j = 0; j < width; j++) {
+            if (label[j] < 0) {
+                continue;
+            }
+            for (int dj = -1; dj <= 1; dj++) {
+                if (j + dj >= 0 && j + dj < width && above[j + dj] >= 0) {
+                    unite(parent, label[j], above[j + dj]);
+                }
+            }
+        }
+    }
+
+    // Pass 2: compact component indices and statistics
+    vector<int> index(parent.size(), -1);
+    vector<Component> components;
+    for (int i = 0; i < height; i++) {
+        int* label = labels[i];
+        for (int j = 0; j < width; j++) {
+            if (label[j] < 0) {
+                continue;
+            }
+            int root = find_root(parent, label[j]);
+            if (index[root] < 0) {
+                index[root] = static_cast<int>(components.size());
+                Component c;
+                c.pixels = 0;
+                c.top = c.bottom = i;
+                c.left = c.right = j;
+                components.push_back(c);
+            }
+            int id = index[root];
+            Component& c = components[id];
+            c.pixels++;
+            c.bottom = i;
+            c.left = std::min(c.left, j);
+            c.right = std::max(c.right, j);
+            label[j] = id;
+        }
+    }
+    return components;
+}
+
+int prune_components(grayMatrix_t& edges, int min_pixels, int min_area) {
+    if (min_pixels <= 0 && min_area <= 0) {
+        return 0;
+    }
+
+    Image<int> labels;
+    vector<Component> components = label_components(edges, labels);
+    if (components.empty()) {
+        return 0;
+    }
+
+    int largest = 0;
+    for (size_t c = 1; c < components.size(); c++) {
+        if (components[c].pixels > components[largest].pixels) {
+            largest = static_cast<int>(c);
+        }
+    }
+
+    vector<uint8_t> drop(components.size(), 0);
+    int pruned = 0;
+    for (size_t c = 0; c < components.size(); c++) {
+        if (static_cast<int>(c) != largest
+            && (components[c].pixels < min_pixels || components[c].box_area() < min_area)) {
+            drop[c] = 1;
+            pruned++;
+        }
+    }
+    if (pruned == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < edges.height(); i++) {
+        uint8_t* row = edges[i];
+        const int* label = labels[i];
+        for (int j = 0; j < edges.width(); j++) {
+            if (label[j] >= 0 && drop[label[j]]) {
+                row[j] = 0;
+            }
+        }
+    }
+    return pruned;
+}
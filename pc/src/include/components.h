@@ -0,0 +1,33 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <string>
+#include "canny.h"
+
+using std::string;
+
+// 8-connected component of edge pixels
+struct Component {
+    int pixels;                      // edge pixel count (trace length)
+    int top, left, bottom, right;    // inclusive bounding box
+
+    int box_area() const { return (bottom - top + 1) * (right - left + 1); }
+};
+
+// Components below either limit are dropped before tracing; 0 disables a limit
+extern int prune_min_pixels;
+extern int prune_min_area;
+
+// Parses OSCILLO_PRUNE as "<min pixels>[,<min bounding-box area>]"
+void configure_pruning();
+
+// Two-pass union-find labelling of the 255 pixels, pass 1 in parallel row bands merged
+// across their seams: labels gets the component index (or -1) per pixel, the returned
+// vector the per-component statistics in raster order
+vector<Component> label_components(const grayMatrix_t& edges, Image<int>& labels);
+
+// Clears every component with fewer than min_pixels pixels or a bounding box smaller
+// than min_area; the largest component is always kept. Returns the number pruned.
+int prune_components(grayMatrix_t& edges, int min_pixels, int min_area);
+
+#endif // COMPONENTS_H
@@ -1,39 +1,65 @@
 #include "constructor.h"
 #include "canny.h"
+#include "thinning.h"
+#include "components.h"
+#include "nearest.h"
 #include <bits/stdc++.h>
-#include <cstdlib>
 
 vector<pii> signalXY;
 vector<pii> points;
 vector<vector<pii>> edges; // bracket order of dfs
 
-matrix<bool> visited;
-matrix<int> belong;
-matrix<int> dfn;
+Image<int> belong;
+Image<int> dfn;
 
 const int dx[] = {-1, -1, -1, 0, 0, 1, 1, 1};
 const int dy[] = {-1, 0, 1, -1, 1, -1, 0, 1};
 
+// Depth-first trace of the component containing (x, y) into edges[e]: every pixel is
+// appended when it is entered and again when all of its neighbours are done (bracket
+// order), and gets its dfn. The recursion is unrolled onto a heap-allocated stack that
+// keeps the next neighbour to try per pixel, so the visiting order is the recursive one
+// and long contours no longer need a huge thread stack.
+struct TraceFrame {
+    int x, y;
+    int next;   // next neighbour direction to try
+};
+
 void dfs(int x, int y, int e) {
-    points.push_back(std::make_pair(x, y));
-    dfn[x][y] = points.size() - 1; 
-    visited[x][y] = true;
-    
-    edges[e].push_back(std::make_pair(x, y));
-    belong[x][y] = e;
+    int height = grayMatrix.height();
+    int width = grayMatrix.width();
+    vector<TraceFrame> stack;
 
-    int height = grayMatrix.size();
-    int width = grayMatrix[0].size();
+    auto enter = [&](int px, int py) {
+        points.push_back(std::make_pair(px, py));
+        dfn[px][py] = points.size() - 1;
+        belong[px][py] = e;
+        edges[e].push_back(std::make_pair(px, py));
+        TraceFrame frame = {px, py, 0};
+        stack.push_back(frame);
+    };
 
-    for (int d = 0; d < 8; d++) {
-        int nx = x + dx[d];
-        int ny = y + dy[d];
-        if (nx >= 0 && nx < height && ny >= 0 && ny < width && grayMatrix[nx][ny] == 255 && !visited[nx][ny]) {
-            dfs(nx, ny, e);
+    enter(x, y);
+    while (!stack.empty()) {
+        TraceFrame& top = stack.back();
+        int nx = -1, ny = -1;
+        while (top.next < 8) {
+            int d = top.next++;
+            int cx = top.x + dx[d];
+            int cy = top.y + dy[d];
+            if (cx >= 0 && cx < height && cy >= 0 && cy < width && grayMatrix[cx][cy] == 255 && belong[cx][cy] < 0) {
+                nx = cx;
+                ny = cy;
+                break;
+            }
+        }
+        if (nx >= 0) {
+            enter(nx, ny);   // invalidates top
+        } else {
+            edges[e].push_back(std::make_pair(top.x, top.y));
+            stack.pop_back();
         }
     }
-    
-    edges[e].push_back(std::make_pair(x, y));
 }
 
 distance::distance() {
@@ -56,112 +82,154 @@ int distance::to_edge() {
     return belong[p2.first][p2.second];
 }
 
-matrix<distance> dist;
-vector<pii> dist_sorted;
+matrix<distance> candidates;
 
 // Prim
 int root;
 vector<vector<distance>> mst;
 
+// Candidate connections compare like the nearest-pair engines' pixel pairs (squared
+// length, then the lower and the higher dfn), so the tree is unique whatever the
+// candidates are
+using LinkKey = std::tuple<int, int, int>;
+
+static LinkKey link_key(const distance& link) {
+    int a = dfn[link.p1.first][link.p1.second];
+    int b = dfn[link.p2.first][link.p2.second];
+    return std::make_tuple(link.d, std::min(a, b), std::max(a, b));
+}
+
+// Prim over the candidate lists with a binary heap of (key, edge); stale heap entries are
+// skipped when popped. O(C log C) in the candidates instead of O(E^2). The tree always
+// grows from edge 0, the first one traced in raster order, so the signal of a frame does
+// not depend on how many frames were processed before it.
 void prim_MST() {
     int n = edges.size();
     if (n == 0) return;
     
+    const LinkKey NONE(INT_MAX, INT_MAX, INT_MAX);
     vector<bool> inMST(n, false);
-    vector<double> key(n, 1e18);
+    vector<LinkKey> key(n, NONE);
     vector<int> parent(n, -1);
+    vector<distance> via(n);    // candidate connection from parent[v] to v
+    using Entry = std::pair<LinkKey, int>;
+    std::priority_queue<Entry, vector<Entry>, std::greater<Entry>> heap;
     
-    // Start from random root
-    root = rand() % n;
-    key[root] = 0;
+    root = 0;
+    key[root] = LinkKey(0, 0, 0);
+    heap.push(std::make_pair(key[root], root));
     
     mst.resize(n);
     
-    for (int count = 0; count < n; count++) {
-        // Find minimum key vertex not in MST
-        int u = -1;
-        for (int v = 0; v < n; v++) {
-            if (!inMST[v] && (u == -1 || key[v] < key[u])) {
-                u = v;
-            }
+    while (!heap.empty()) {
+        int u = heap.top().second;
+        heap.pop();
+        if (inMST[u]) {
+            continue;
         }
-        
         inMST[u] = true;
         
         // Add edge to MST if not root
         if (parent[u] != -1) {
-            mst[u].push_back(dist[u][parent[u]]);
-            mst[parent[u]].push_back(dist[parent[u]][u]);
+            distance back = via[u];
+            std::swap(back.p1, back.p2);
+            mst[u].push_back(back);
+            mst[parent[u]].push_back(via[u]);
         }
         
         // Update key values of adjacent vertices
-        for (int v = 0; v < n; v++) {
-            if (!inMST[v] && dist[u][v].d < key[v]) {
-                key[v] = dist[u][v].d;
+        for (distance& link : candidates[u]) {
+            int v = link.to_edge();
+            LinkKey k = link_key(link);
+            if (!inMST[v] && k < key[v]) {
+                key[v] = k;
                 parent[v] = u;
+                via[v] = link;
+                heap.push(std::make_pair(key[v], v));
             }
         }
     }
 }
 
-// int max_cnt = 0;
+// Walks edge u's bracket-order ring from starting_point, detouring into each MST child
+// at its connecting pixel (in ring order) and coming back to the same pixel afterwards.
+// Children are entered through an explicit stack, so deep trees need no call stack.
+struct TravelFrame {
+    int u;
+    size_t cur;     // current position in edges[u]
+    size_t start;   // where the walk around edges[u] started
+    size_t child;   // next mst[u] entry to visit
+};
+
 void travel(int u, int fa, pii starting_point) {
-    for (auto it = mst[u].begin(); it != mst[u].end(); it++) {
-        if (it->to_edge() == fa) {
-            mst[u].erase(it);
-            break;
+    vector<TravelFrame> stack;
+
+    auto enter = [&](int v, int parent, pii start) {
+        for (auto it = mst[v].begin(); it != mst[v].end(); it++) {
+            if (it->to_edge() == parent) {
+                mst[v].erase(it);
+                break;
+            }
         }
-    }
 
-    std::sort(mst[u].begin(), mst[u].end(), [&](const distance& a, const distance& b) {
-        pii pa = a.p1, pb = b.p1;
-        return dfn[pa.first][pa.second] < dfn[pb.first][pb.second];
-    });
-    
-    // int cnt = 0;
-    auto cur_edge_it = edges[u].begin();
-    auto go_to_next = [&]() {
-        ++cur_edge_it;
-        if (cur_edge_it == edges[u].end()) {
-            cur_edge_it = edges[u].begin();
-            // ++cnt;
+        std::sort(mst[v].begin(), mst[v].end(), [&](const distance& a, const distance& b) {
+            pii pa = a.p1, pb = b.p1;
+            return dfn[pa.first][pa.second] < dfn[pb.first][pb.second];
+        });
+
+        size_t cur = 0;
+        while (edges[v][cur] != start) {
+            cur = (cur + 1) % edges[v].size();
         }
+        TravelFrame frame = {v, cur, cur, 0};
+        stack.push_back(frame);
     };
 
-    while (*cur_edge_it != starting_point) {
-        go_to_next();
-    }
-    auto starting_it = cur_edge_it;
-
-    // cnt = 0;
-    for (auto v : mst[u]) {
-        while (*cur_edge_it != v.p1) {
-            signalXY.push_back(*cur_edge_it);
-            go_to_next();
+    enter(u, fa, starting_point);
+    while (!stack.empty()) {
+        TravelFrame& top = stack.back();
+        const vector<pii>& ring = edges[top.u];
+        if (top.child < mst[top.u].size()) {
+            distance& v = mst[top.u][top.child++];
+            while (ring[top.cur] != v.p1) {
+                signalXY.push_back(ring[top.cur]);
+                top.cur = (top.cur + 1) % ring.size();
+            }
+            signalXY.push_back(ring[top.cur]);
+            enter(v.to_edge(), top.u, v.p2);   // invalidates top
+        } else {
+            size_t i = top.cur;
+            do {
+                signalXY.push_back(ring[i]);
+                i = (i + 1) % ring.size();
+            } while (i != top.start);
+            stack.pop_back();
         }
-        signalXY.push_back(*cur_edge_it);
-        travel(v.to_edge(), u, v.p2);
     }
-
-    do {
-        signalXY.push_back(*cur_edge_it);
-        go_to_next();
-    } while (cur_edge_it != starting_it);
-
-    // max_cnt = std::max(max_cnt, cnt);
 }
 
 void construct_signal() {
-    int height = grayMatrix.size();
-    int width = grayMatrix[0].size();
-    visited = matrix<bool>(height, vector<bool>(width, false));
-    belong = matrix<int>(height, vector<int>(width, -1));
-    dfn = matrix<int>(height, vector<int>(width, -1));
+    // Thick edges and staircase corners would each be traced pixel by pixel
+    if (thinning_enabled) {
+        int removed = thin_edges(grayMatrix);
+        std::cout << "thinning removed : " << removed << std::endl;
+    }
+
+    // Every speck would be a vertex of the nearest-pair and MST stages
+    if (prune_min_pixels > 0 || prune_min_area > 0) {
+        int pruned = prune_components(grayMatrix, prune_min_pixels, prune_min_area);
+        std::cout << "pruned components : " << pruned << std::endl;
+    }
+
+    int height = grayMatrix.height();
+    int width = grayMatrix.width();
+    belong = Image<int>(width, height, -1);
+    dfn = Image<int>(width, height, -1);
 
     for (int i = 0; i < height; i++) {
         for (int j = 0; j < width; j++) {
             if (grayMatrix[i][j] == 255) {
-                if (visited[i][j]) {
+                if (belong[i][j] >= 0) {
                     continue;
                 }
                 edges.push_back(vector<pii>());
@@ -172,31 +240,13 @@ void construct_signal() {
     std::cout << "points : " << points.size() << std::endl;
     std::cout << "edges : " << edges.size() << std::endl;
 
-    dist = matrix<distance>(edges.size(), vector<distance>(edges.size()));
-    // for (int i = 0; i < points.size(); i++) {
-    //     for (int j = i + 1; j < points.size(); j++) {
-    //         distance d(points[i], points[j]);
-    //         int u = belong[points[i].first][points[i].second];
-    //         int v = belong[points[j].first][points[j].second];
-    //         if (d < dist[u][v]) {
-    //             dist[u][v] = d;
-    //             std::swap(d.p1, d.p2);
-    //             dist[v][u] = d;
-    //         }
-    //     }
-    // }
-    for (int i = 0; i < edges.size(); i++) {
-        for (int j = i + 1; j < edges.size(); j++) {
-            for (int u = 0; u < edges[i].size(); u++) {
-                for (int v = 0; v < edges[j].size(); v++) {
-                    distance d(edges[i][u], edges[j][v]);
-                    if (d < dist[i][j]) 
-                        dist[i][j] = d;
-                }
-            }
-            dist[j][i] = dist[i][j];
-            swap(dist[j][i].p1, dist[j][i].p2);
-        }
+    // Only the candidate connections are stored, each from both ends
+    candidates = matrix<distance>(edges.size());
+    for (distance& link : component_candidates(points, belong, edges.size())) {
+        distance back = link;
+        std::swap(back.p1, back.p2);
+        candidates[link.from_edge()].push_back(link);
+        candidates[back.from_edge()].push_back(back);
     }
     
     prim_MST();
@@ -13,9 +13,8 @@ using pii = pair<int, int>;
 extern vector<pii> signalXY;
 extern vector<pii> points;
 extern vector<vector<pii>> edges;
-extern matrix<bool> visited;
-extern matrix<int> belong;
-extern matrix<int> dfn;
+extern Image<int> belong;   // edge index per traced pixel, -1 = not traced yet
+extern Image<int> dfn;
 
 // Distance structure
 struct distance {
@@ -28,8 +27,9 @@ struct distance {
     int to_edge();
 };
 
-extern matrix<distance> dist;
-extern vector<pii> dist_sorted;
+// Candidate connections out of each edge (p1 on that edge). Sparse: every connection is
+// stored once from each side, so memory grows with the number of candidates, not E^2
+extern matrix<distance> candidates;
 
 // MST variables
 extern int root;
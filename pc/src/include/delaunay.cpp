@@ -0,0 +1,263 @@
+#include "delaunay.h"
+#include <bits/stdc++.h>
+
+// Quad-edge records: edge e's four directed versions are e, rot(e), sym(e), invrot(e)
+// at consecutive indices; only the primal ones (e and sym(e)) carry an origin.
+class QuadEdges {
+private:
+    vector<int> next_;      // onext
+    vector<int> origin_;    // site index of org(e)
+    vector<uint8_t> dead_;  // per quad-edge, set by remove()
+
+public:
+    explicit QuadEdges(size_t sites) {
+        next_.reserve(sites * 12);
+        origin_.reserve(sites * 12);
+        dead_.reserve(sites * 3);
+    }
+
+    static int rot(int e) { return (e & ~3) | ((e + 1) & 3); }
+    static int sym(int e) { return (e & ~3) | ((e + 2) & 3); }
+    static int invrot(int e) { return (e & ~3) | ((e + 3) & 3); }
+
+    int onext(int e) const { return next_[e]; }
+    int oprev(int e) const { return rot(onext(rot(e))); }
+    int lnext(int e) const { return rot(onext(invrot(e))); }
+    int rprev(int e) const { return onext(sym(e)); }
+    int org(int e) const { return origin_[e]; }
+    int dest(int e) const { return origin_[sym(e)]; }
+
+    int count() const { return static_cast<int>(dead_.size()); }
+    bool alive(int q) const { return !dead_[q]; }
+
+    int make(int from, int to) {
+        int e = static_cast<int>(next_.size());
+        next_.push_back(e);
+        next_.push_back(e + 3);
+        next_.push_back(e + 2);
+        next_.push_back(e + 1);
+        origin_.push_back(from);
+        origin_.push_back(-1);
+        origin_.push_back(to);
+        origin_.push_back(-1);
+        dead_.push_back(0);
+        return e;
+    }
+
+    void splice(int a, int b) {
+        int alpha = rot(onext(a));
+        int beta = rot(onext(b));
+        std::swap(next_[a], next_[b]);
+        std::swap(next_[alpha], next_[beta]);
+    }
+
+    // New edge from dest(a) to org(b), in the face left of both
+    int connect(int a, int b) {
+        int e = make(dest(a), org(b));
+        splice(e, lnext(a));
+        splice(sym(e), b);
+        return e;
+    }
+
+    void remove(int e) {
+        splice(e, oprev(e));
+        splice(sym(e), oprev(sym(e)));
+        dead_[e >> 2] = 1;
+    }
+};
+
+// Exact predicates on integer coordinates; __int128 keeps incircle exact for any int
+// image size
+static inline long long cross(const pii& a, const pii& b, const pii& c) {
+    return static_cast<long long>(b.first - a.first) * (c.second - a.second)
+         - static_cast<long long>(b.second - a.second) * (c.first - a.first);
+}
+
+static inline bool ccw(const pii& a, const pii& b, const pii& c) {
+    return cross(a, b, c) > 0;
+}
+
+// d strictly inside the circle through a, b, c (counterclockwise)
+static bool in_circle(const pii& a, const pii& b, const pii& c, const pii& d) {
+    long long adx = a.first - d.first, ady = a.second - d.second;
+    long long bdx = b.first - d.first, bdy = b.second - d.second;
+    long long cdx = c.first - d.first, cdy = c.second - d.second;
+    __int128 det = static_cast<__int128>(adx * adx + ady * ady) * (bdx * cdy - cdx * bdy)
+                 + static_cast<__int128>(bdx * bdx + bdy * bdy) * (cdx * ady - adx * cdy)
+                 + static_cast<__int128>(cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+    return det > 0;
+}
+
+class Triangulator {
+private:
+    const vector<pii>& site;    // sorted by (first, second)
+    QuadEdges& q;
+
+    bool right_of(int s, int e) const { return ccw(site[s], site[q.dest(e)], site[q.org(e)]); }
+    bool left_of(int s, int e) const { return ccw(site[s], site[q.org(e)], site[q.dest(e)]); }
+    bool valid(int e, int basel) const { return right_of(q.dest(e), basel); }
+
+public:
+    Triangulator(const vector<pii>& sorted, QuadEdges& edges) : site(sorted), q(edges) {}
+
+    // Triangulates sites [lo, hi) (at least 2); returns the counterclockwise convex
+    // hull edge out of the leftmost site and the clockwise one out of the rightmost
+    std::pair<int, int> run(int lo, int hi) {
+        int n = hi - lo;
+        if (n == 2) {
+            int a = q.make(lo, lo + 1);
+            return std::make_pair(a, QuadEdges::sym(a));
+        }
+        if (n == 3) {
+            int a = q.make(lo, lo + 1);
+            int b = q.make(lo + 1, lo + 2);
+            q.splice(QuadEdges::sym(a), b);
+            if (ccw(site[lo], site[lo + 1], site[lo + 2])) {
+                q.connect(b, a);
+                return std::make_pair(a, QuadEdges::sym(b));
+            }
+            if (ccw(site[lo], site[lo + 2], site[lo + 1])) {
+                int c = q.connect(b, a);
+                return std::make_pair(QuadEdges::sym(c), c);
+            }
+            return std::make_pair(a, QuadEdges::sym(b));   // collinear
+        }
+
+        int mid = lo + n / 2;
+        std::pair<int, int> left = run(lo, mid);
+        std::pair<int, int> right = run(mid, hi);
+        int ldo = left.first, ldi = left.second;
+        int rdi = right.first, rdo = right.second;
+
+        // Lower common tangent of the two hulls
+        while (true) {
+            if (left_of(q.org(rdi), ldi)) {
+                ldi = q.lnext(ldi);
+            } else if (right_of(q.org(ldi), rdi)) {
+                rdi = q.rprev(rdi);
+            } else {
+                break;
+            }
+        }
+
+        int basel = q.connect(QuadEdges::sym(rdi), ldi);
+        if (q.org(ldi) == q.org(ldo)) {
+            ldo = QuadEdges::sym(basel);
+        }
+        if (q.org(rdi) == q.org(rdo)) {
+            rdo = basel;
+        }
+
+        // Zip the halves together bottom-up, dropping edges that fail the circle test
+        while (true) {
+            int lcand = q.onext(QuadEdges::sym(basel));
+            if (valid(lcand, basel)) {
+                while (in_circle(site[q.dest(basel)], site[q.org(basel)], site[q.dest(lcand)],
+                                 site[q.dest(q.onext(lcand))])) {
+                    int t = q.onext(lcand);
+                    q.remove(lcand);
+                    lcand = t;
+                }
+            }
+            int rcand = q.oprev(basel);
+            if (valid(rcand, basel)) {
+                while (in_circle(site[q.dest(basel)], site[q.org(basel)], site[q.dest(rcand)],
+                                 site[q.dest(q.oprev(rcand))])) {
+                    int t = q.oprev(rcand);
+                    q.remove(rcand);
+                    rcand = t;
+                }
+            }
+            bool lvalid = valid(lcand, basel);
+            bool rvalid = valid(rcand, basel);
+            if (!lvalid && !rvalid) {
+                break;
+            }
+            if (!lvalid || (rvalid && in_circle(site[q.dest(lcand)], site[q.org(lcand)],
+                                                site[q.org(rcand)], site[q.dest(rcand)]))) {
+                basel = q.connect(rcand, QuadEdges::sym(basel));
+            } else {
+                basel = q.connect(QuadEdges::sym(basel), QuadEdges::sym(lcand));
+            }
+        }
+        return std::make_pair(ldo, rdo);
+    }
+};
+
+vector<pii> delaunay_edges(const vector<pii>& sites) {
+    vector<pii> result;
+    int n = sites.size();
+    if (n < 2) {
+        return result;
+    }
+
+    vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return sites[a] < sites[b]; });
+    vector<pii> sorted(n);
+    for (int i = 0; i < n; i++) {
+        sorted[i] = sites[order[i]];
+    }
+
+    QuadEdges q(n);
+    Triangulator(sorted, q).run(0, n);
+
+    result.reserve(q.count());
+    for (int k = 0; k < q.count(); k++) {
+        if (q.alive(k)) {
+            result.push_back(std::make_pair(order[q.org(4 * k)], order[q.dest(4 * k)]));
+        }
+    }
+    return result;
+}
+
+// Candidate connection: squared length, then the dfn of both pixels (lo < hi)
+struct Link {
+    int d;
+    int lo, hi;
+
+    bool operator<(const Link& other) const {
+        if (d != other.d) return d < other.d;
+        if (lo != other.lo) return lo < other.lo;
+        return hi < other.hi;
+    }
+};
+
+vector<distance> delaunay_component_links(const vector<pii>& points, const Image<int>& belong, int components) {
+    vector<distance> result;
+    if (components < 2) {
+        return result;
+    }
+
+    vector<int> component(points.size());
+    for (size_t p = 0; p < points.size(); p++) {
+        component[p] = belong[points[p].first][points[p].second];
+    }
+
+    vector<Link> links;
+    for (const pii& e : delaunay_edges(points)) {
+        if (component[e.first] == component[e.second]) {
+            continue;
+        }
+        const pii& a = points[e.first];
+        const pii& b = points[e.second];
+        int dx = a.first - b.first, dy = a.second - b.second;
+        Link link = {dx * dx + dy * dy, std::min(e.first, e.second), std::max(e.first, e.second)};
+        links.push_back(link);
+    }
+
+    // Grouped by component pair (the lower dfn is in the lower component), best link first
+    std::sort(links.begin(), links.end(), [&](const Link& a, const Link& b) {
+        if (component[a.lo] != component[b.lo]) return component[a.lo] < component[b.lo];
+        if (component[a.hi] != component[b.hi]) return component[a.hi] < component[b.hi];
+        return a < b;
+    });
+    for (size_t k = 0; k < links.size(); k++) {
+        if (k > 0 && component[links[k].lo] == component[links[k - 1].lo]
+            && component[links[k].hi] == component[links[k - 1].hi]) {
+            continue;
+        }
+        result.push_back(distance(points[links[k].lo], points[links[k].hi]));
+    }
+    return result;
+}
@@ -0,0 +1,20 @@
+#ifndef DELAUNAY_H
+#define DELAUNAY_H
+
+#include "constructor.h"
+
+// Delaunay triangulation of a point set (Guibas-Stolfi divide and conquer on a
+// quad-edge structure, exact integer predicates, so lattice points and collinear runs
+// are fine). Points must be distinct. Returns each triangulation edge once as a pair
+// of indices into `sites`.
+vector<pii> delaunay_edges(const vector<pii>& sites);
+
+// Candidate graph for the component spanning tree: for every pair of components joined
+// by a Delaunay edge of the traced points, their closest such pixel pair (p1 in the
+// lower-numbered component). The triangulation is planar and connected, so this is
+// O(P) links that connect all components. It contains the tree of grid_component_mst
+// (see nearest.h): the closest pixel pair across any split of the components has an
+// empty diametral disk, so it is an edge of every Delaunay triangulation.
+vector<distance> delaunay_component_links(const vector<pii>& points, const Image<int>& belong, int components);
+
+#endif // DELAUNAY_H
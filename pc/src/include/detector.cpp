@@ -0,0 +1,402 @@
+#include "detector.h"
+#include "dump.h"
+#include <bits/stdc++.h>
+#include <chrono>
+
+grayMatrix_t EdgeDetector::detect(const grayMatrix_t& gray, const DetectorParams& params) {
+    auto start = std::chrono::steady_clock::now();
+    grayMatrix_t edges = extract(gray, params);
+    auto stop = std::chrono::steady_clock::now();
+
+    lastMs_ = std::chrono::duration<double, std::milli>(stop - start).count();
+    totalMs_ += lastMs_;
+    frames_++;
+    std::cout << "Edge detector " << name() << ": " << lastMs_ << " ms" << std::endl;
+    return edges;
+}
+
+void EdgeDetector::report() const {
+    std::cout << "Edge detector " << name() << ": " << frames_ << " frames, "
+              << totalMs_ << " ms total";
+    if (frames_ > 0) {
+        std::cout << ", " << totalMs_ / frames_ << " ms per frame";
+    }
+    std::cout << std::endl;
+}
+
+// Edge map from a cached magnitude, with the point-budget search when asked for
+static grayMatrix_t threshold_params(const SuppressedCache& cache, const DetectorParams& params) {
+    if (params.targetPoints > 0) {
+        double high = params.highThreshold;
+        double low = params.lowThreshold;
+        double ratio = (high > 0 && low > 0 && low <= high) ? low / high : AUTO_LOW_RATIO;
+        int high_level, low_level;
+        return canny_target_points(cache, params.targetPoints, ratio, high_level, low_level);
+    }
+    return threshold_cached(cache, params.lowThreshold, params.highThreshold);
+}
+
+grayMatrix_t CannyDetector::extract(const grayMatrix_t& gray, const DetectorParams& params) {
+    if (params.targetPoints > 0) {
+        return threshold_params(suppressed_magnitude(gray), params);
+    }
+    return canny_fused(gray, params.lowThreshold, params.highThreshold);
+}
+
+static bool same_params(const DetectorParams& a, const DetectorParams& b) {
+    return a.highThreshold == b.highThreshold && a.lowThreshold == b.lowThreshold
+        && a.targetPoints == b.targetPoints;
+}
+
+// The point-budget search thresholds from scratch every time; fixed thresholds also
+// keep the pre-hysteresis classes for threshold_cached_update
+void TemporalCannyDetector::rethreshold(const DetectorParams& params) {
+    if (params.targetPoints > 0) {
+        classes.clear();
+        edges = threshold_params(cache, params);
+    } else {
+        classes = classify_cached(cache, params.lowThreshold, params.highThreshold);
+        edges = classes;
+        hysteresis(edges);
+    }
+    lastParams = params;
+}
+
+grayMatrix_t TemporalCannyDetector::extract(const grayMatrix_t& gray, const DetectorParams& params) {
+    int height = gray.height();
+    int width = gray.width();
+    if (!valid || previous.width() != width || previous.height() != height) {
+        previous = gray;
+        cache = suppressed_magnitude(gray);
+        rethreshold(params);
+        valid = true;
+        return edges;
+    }
+    int out_height = cache.magnitude.height();
+    int out_width = cache.magnitude.width();
+    int out_tile_cols = (out_width + TEMPORAL_TILE - 1) / TEMPORAL_TILE;
+    int out_tiles = ((out_height + TEMPORAL_TILE - 1) / TEMPORAL_TILE) * out_tile_cols;
+
+    // Changed input tiles
+    int tile_rows = (height + TEMPORAL_TILE - 1) / TEMPORAL_TILE;
+    int tile_cols = (width + TEMPORAL_TILE - 1) / TEMPORAL_TILE;
+    vector<uint8_t> changed(tile_rows * tile_cols, 0);
+    int changed_tiles = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* a = gray[y];
+        const uint8_t* b = previous[y];
+        uint8_t* flags = &changed[(y / TEMPORAL_TILE) * tile_cols];
+        for (int tx = 0; tx < tile_cols; tx++) {
+            if (flags[tx]) {
+                continue;
+            }
+            int x0 = tx * TEMPORAL_TILE;
+            int x1 = std::min(x0 + TEMPORAL_TILE, width);
+            if (std::memcmp(a + x0, b + x0, x1 - x0) != 0) {
+                flags[tx] = 1;
+                changed_tiles++;
+            }
+        }
+    }
+
+    if (changed_tiles == 0) {
+        if (!same_params(params, lastParams)) {
+            rethreshold(params);
+        }
+        std::cout << "Dirty tiles: 0/" << out_tiles << std::endl;
+        return edges;
+    }
+
+    // Suppressed pixel (t, c) reads input rows t - 1 .. t + 5 and the same columns, so an
+    // output tile is dirty when that window touches a changed input tile. Dirty runs
+    // along a tile row become one rectangle.
+    vector<TileRect> regions;
+    int dirty_tiles = 0;
+    for (int ty = 0; ty * TEMPORAL_TILE < out_height; ty++) {
+        int top = ty * TEMPORAL_TILE;
+        int bottom = std::min(top + TEMPORAL_TILE, out_height);
+        int in_ty0 = std::max(top - 1, 0) / TEMPORAL_TILE;
+        int in_ty1 = std::min(bottom + 4, height - 1) / TEMPORAL_TILE;
+        int run_start = -1;
+        // tx == out_tile_cols is a clean sentinel that closes a run reaching the right edge
+        for (int tx = 0; tx <= out_tile_cols; tx++) {
+            bool dirty = false;
+            int left = tx * TEMPORAL_TILE;
+            if (left < out_width) {
+                int right = std::min(left + TEMPORAL_TILE, out_width);
+                int in_tx0 = std::max(left - 1, 0) / TEMPORAL_TILE;
+                int in_tx1 = std::min(right + 4, width - 1) / TEMPORAL_TILE;
+                for (int iy = in_ty0; iy <= in_ty1 && !dirty; iy++) {
+                    for (int ix = in_tx0; ix <= in_tx1 && !dirty; ix++) {
+                        dirty = changed[iy * tile_cols + ix] != 0;
+                    }
+                }
+            }
+            if (dirty) {
+                dirty_tiles++;
+                if (run_start < 0) {
+                    run_start = left;
+                }
+            } else if (run_start >= 0) {
+                TileRect rect = {top, run_start, bottom, std::min(left, out_width)};
+                regions.push_back(rect);
+                run_start = -1;
+            }
+        }
+    }
+
+    int min_value = cache.min_value;
+    int max_value = cache.max_value;
+    update_suppressed(cache, gray, regions);
+    previous = gray;
+
+    // Same absolute thresholds: only the components around the dirty tiles can change
+    if (!classes.empty() && same_params(params, lastParams)
+        && cache.min_value == min_value && cache.max_value == max_value) {
+        threshold_cached_update(cache, params.lowThreshold, params.highThreshold, regions, classes, edges);
+    } else {
+        rethreshold(params);
+    }
+
+    std::cout << "Dirty tiles: " << dirty_tiles << "/" << out_tiles << std::endl;
+    return edges;
+}
+
+// Otsu's threshold: the level maximizing the between-class variance of the histogram
+static int otsu_threshold(const grayMatrix_t& gray) {
+    vector<long long> histogram(256, 0);
+    for (int i = 0; i < gray.height(); i++) {
+        const uint8_t* row = gray[i];
+        for (int j = 0; j < gray.width(); j++) {
+            histogram[row[j]]++;
+        }
+    }
+
+    long long total = static_cast<long long>(gray.width()) * gray.height();
+    double sum_all = 0;
+    for (int v = 0; v < 256; v++) {
+        sum_all += static_cast<double>(v) * histogram[v];
+    }
+
+    long long below = 0;
+    double sum_below = 0;
+    double best = -1;
+    int threshold = 0;
+    for (int t = 0; t < 256; t++) {
+        below += histogram[t];
+        sum_below += static_cast<double>(t) * histogram[t];
+        long long above = total - below;
+        if (below == 0 || above == 0) {
+            continue;
+        }
+        double mean_below = sum_below / below;
+        double mean_above = (sum_all - sum_below) / above;
+        double between = static_cast<double>(below) * above * (mean_below - mean_above) * (mean_below - mean_above);
+        if (between > best) {
+            best = between;
+            threshold = t;
+        }
+    }
+    return threshold;
+}
+
+// Contour of the dark class: a dark pixel is kept when one of its 4-neighbours is
+// light. Pixels outside the image count as dark, so the frame border is no edge.
+grayMatrix_t ThresholdContourDetector::extract(const grayMatrix_t& gray, const DetectorParams&) {
+    int height = gray.height();
+    int width = gray.width();
+    grayMatrix_t result(width, height, 0);
+    if (gray.empty()) {
+        return result;
+    }
+
+    int threshold = otsu_threshold(gray);
+    grayMatrix_t dark(width, height);
+    for (int i = 0; i < height; i++) {
+        const uint8_t* src = gray[i];
+        uint8_t* dst = dark[i];
+        for (int j = 0; j < width; j++) {
+            dst[j] = src[j] <= threshold ? 1 : 0;
+        }
+    }
+
+    for (int i = 0; i < height; i++) {
+        const uint8_t* up = dark[std::max(i - 1, 0)];
+        const uint8_t* cur = dark[i];
+        const uint8_t* down = dark[std::min(i + 1, height - 1)];
+        uint8_t* out = result[i];
+        for (int j = 0; j < width; j++) {
+            uint8_t left = cur[std::max(j - 1, 0)];
+            uint8_t right = cur[std::min(j + 1, width - 1)];
+            out[j] = (cur[j] & ~(up[j] & down[j] & left & right) & 1) ? 255 : 0;
+        }
+    }
+    return result;
+}
+
+// Separable Gaussian with clamped borders, float output
+static Image<float> gaussian_float(const grayMatrix_t& input, double sigma) {
+    int radius = std::max(1, static_cast<int>(std::ceil(3 * sigma)));
+    vector<float> taps(2 * radius + 1);
+    double total = 0;
+    for (int t = -radius; t <= radius; t++) {
+        taps[t + radius] = static_cast<float>(std::exp(-t * t / (2 * sigma * sigma)));
+        total += taps[t + radius];
+    }
+    for (size_t t = 0; t < taps.size(); t++) {
+        taps[t] = static_cast<float>(taps[t] / total);
+    }
+
+    int height = input.height();
+    int width = input.width();
+    Image<float> horizontal(width, height);
+    for (int i = 0; i < height; i++) {
+        const uint8_t* src = input[i];
+        float* dst = horizontal[i];
+        for (int j = 0; j < width; j++) {
+            float acc = 0;
+            for (int t = -radius; t <= radius; t++) {
+                acc += taps[t + radius] * src[std::min(std::max(j + t, 0), width - 1)];
+            }
+            dst[j] = acc;
+        }
+    }
+
+    Image<float> result(width, height, 0.0f);
+    for (int i = 0; i < height; i++) {
+        float* dst = result[i];
+        for (int t = -radius; t <= radius; t++) {
+            const float* src = horizontal[std::min(std::max(i + t, 0), height - 1)];
+            float w = taps[t + radius];
+            for (int j = 0; j < width; j++) {
+                dst[j] += w * src[j];
+            }
+        }
+    }
+    return result;
+}
+
+grayMatrix_t XDoGDetector::extract(const grayMatrix_t& gray, const DetectorParams&) {
+    int height = gray.height();
+    int width = gray.width();
+    grayMatrix_t result(width, height, 0);
+    if (gray.empty()) {
+        return result;
+    }
+
+    Image<float> narrow = gaussian_float(gray, sigma);
+    Image<float> wide = gaussian_float(gray, k * sigma);
+    float t = static_cast<float>(tau);
+    float e = static_cast<float>(epsilon);
+    for (int i = 0; i < height; i++) {
+        const float* a = narrow[i];
+        const float* b = wide[i];
+        uint8_t* out = result[i];
+        for (int j = 0; j < width; j++) {
+            out[j] = a[j] - t * b[j] < e ? 255 : 0;
+        }
+    }
+    return result;
+}
+
+static CannyDetector cannyDetector;
+static ThresholdContourDetector thresholdDetector;
+static XDoGDetector xdogDetector;
+static TemporalCannyDetector temporalCannyDetector;
+static EdgeDetector* activeDetector = &cannyDetector;
+static bool animationMode = false;
+
+EdgeDetector& active_detector() {
+    if (animationMode && activeDetector == &cannyDetector) {
+        return temporalCannyDetector;
+    }
+    return *activeDetector;
+}
+
+void set_animation_mode(bool enabled) {
+    animationMode = enabled;
+    temporalCannyDetector.reset();
+}
+
+bool select_detector(const string& spec) {
+    string name = spec;
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if (name == "canny") {
+        activeDetector = &cannyDetector;
+    } else if (name == "threshold") {
+        activeDetector = &thresholdDetector;
+    } else if (name == "xdog") {
+        activeDetector = &xdogDetector;
+    } else {
+        std::cerr << "Warning: unknown edge detector '" << spec << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void configure_detector() {
+    const char* spec = std::getenv("OSCILLO_DETECTOR");
+    if (spec) {
+        select_detector(spec);
+    }
+}
+
+static bool has_edge(const grayMatrix_t& edges) {
+    for (int i = 0; i < edges.height(); i++) {
+        const uint8_t* row = edges[i];
+        for (int j = 0; j < edges.width(); j++) {
+            if (row[j] == 255) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Edge map of the image initialize() left in grayMatrix
+static void detect_loaded(double highThreshold, double lowThreshold, int targetPoints) {
+    if (grayMatrix.empty()) {
+        return;
+    }
+    if (single_color()) {
+        grayMatrix_t result(grayMatrix.width(), grayMatrix.height(), 0);
+        result[0][0] = 255;
+        grayMatrix = result;
+        return;
+    }
+
+    DetectorParams params;
+    params.highThreshold = highThreshold;
+    params.lowThreshold = lowThreshold;
+    params.targetPoints = targetPoints;
+    grayMatrix = active_detector().detect(grayMatrix, params);
+
+    // construct_signal needs at least one edge pixel to start the tour from
+    if (!grayMatrix.empty() && !has_edge(grayMatrix)) {
+        grayMatrix[0][0] = 255;
+    }
+
+    // Save as BMP file (written in the background)
+    if (dump_image(DUMP_CANNY, grayMatrix, "canny.bmp")) {
+        std::cout << "Result canny.bmp saved." << std::endl;
+    }
+}
+
+bool detect_edges(string srcFile, double highThreshold, double lowThreshold, int targetPoints) {
+    // initialize() returns nonzero and leaves grayMatrix empty when the file can't be read
+    if (initialize(srcFile)) {
+        std::cerr << "Error: cannot read image " << srcFile << std::endl;
+        return false;
+    }
+    detect_loaded(highThreshold, lowThreshold, targetPoints);
+    return true;
+}
+
+bool detect_edges(const grayMatrix_t& frame, double highThreshold, double lowThreshold, int targetPoints) {
+    if (initialize(frame)) {
+        std::cerr << "Error: empty frame" << std::endl;
+        return false;
+    }
+    detect_loaded(highThreshold, lowThreshold, targetPoints);
+    return true;
+}
@@ -0,0 +1,122 @@
+#ifndef DETECTOR_H
+#define DETECTOR_H
+
+#include <string>
+#include "canny.h"
+
+using std::string;
+
+// Thresholds as entered at the prompt; targetPoints > 0 asks for automatic ones
+struct DetectorParams {
+    double highThreshold;
+    double lowThreshold;
+    int targetPoints;
+};
+
+// Edge-extraction backend: gray image in, binary (0 / 255) edge map out.
+// detect() times every call so backends can be compared on long animations.
+class EdgeDetector {
+private:
+    int frames_;
+    double totalMs_;
+    double lastMs_;
+
+protected:
+    virtual grayMatrix_t extract(const grayMatrix_t& gray, const DetectorParams& params) = 0;
+
+public:
+    EdgeDetector() : frames_(0), totalMs_(0), lastMs_(0) {}
+    virtual ~EdgeDetector() {}
+
+    virtual const char* name() const = 0;
+
+    grayMatrix_t detect(const grayMatrix_t& gray, const DetectorParams& params);
+
+    int frames() const { return frames_; }
+    double totalMs() const { return totalMs_; }
+    double lastMs() const { return lastMs_; }
+
+    // Prints frame count, total and average time
+    void report() const;
+};
+
+// Fused / point-budget Canny from canny.cpp
+class CannyDetector : public EdgeDetector {
+protected:
+    grayMatrix_t extract(const grayMatrix_t& gray, const DetectorParams& params);
+public:
+    const char* name() const { return "canny"; }
+};
+
+// Canny for animations: input tiles that match the previous frame keep their cached
+// suppressed magnitude, and only changed tiles plus the NMS halo are recomputed.
+// With fixed thresholds and an unchanged magnitude range, hysteresis is redone only for
+// the weak/strong chains touching those tiles and the rest of the edge map carries over.
+class TemporalCannyDetector : public CannyDetector {
+private:
+    grayMatrix_t previous;    // last input frame
+    SuppressedCache cache;    // its suppressed magnitude
+    grayMatrix_t classes;     // strong/weak map before hysteresis; empty in point-budget mode
+    grayMatrix_t edges;       // final edge map
+    DetectorParams lastParams;
+    bool valid;
+
+    void rethreshold(const DetectorParams& params);
+protected:
+    grayMatrix_t extract(const grayMatrix_t& gray, const DetectorParams& params);
+public:
+    TemporalCannyDetector() : valid(false) {}
+    const char* name() const { return "canny-temporal"; }
+
+    // Forgets the previous frame
+    void reset() { valid = false; }
+};
+
+// Input tile side for the temporal diff
+const int TEMPORAL_TILE = 32;
+
+// Otsu binarization, then the dark pixels that touch a light 4-neighbour.
+// Meant for high-contrast line art; the Canny thresholds are ignored.
+class ThresholdContourDetector : public EdgeDetector {
+protected:
+    grayMatrix_t extract(const grayMatrix_t& gray, const DetectorParams& params);
+public:
+    const char* name() const { return "threshold"; }
+};
+
+// Thresholded difference of Gaussians G(sigma) - tau * G(k * sigma) (XDoG);
+// pixels below epsilon (in gray levels) are strokes. The Canny thresholds are ignored.
+class XDoGDetector : public EdgeDetector {
+private:
+    double sigma;
+    double k;
+    double tau;
+    double epsilon;
+protected:
+    grayMatrix_t extract(const grayMatrix_t& gray, const DetectorParams& params);
+public:
+    XDoGDetector() : sigma(1.0), k(1.6), tau(0.98), epsilon(-5.0) {}
+    const char* name() const { return "xdog"; }
+};
+
+// Backend used by detect_edges(); Canny unless select_detector() says otherwise
+EdgeDetector& active_detector();
+
+// Picks "canny", "threshold" or "xdog"; returns false (and keeps the current one) otherwise
+bool select_detector(const string& spec);
+
+// Selects the backend from the OSCILLO_DETECTOR environment variable, if set
+void configure_detector();
+
+// In animation mode the Canny backend keeps state between frames (TemporalCannyDetector);
+// turning it on starts from an empty history
+void set_animation_mode(bool enabled);
+
+// Reads srcFile into grayMatrix and replaces it with the active backend's edge map.
+// Returns false (grayMatrix left empty) if the file can't be read as an image.
+bool detect_edges(string srcFile, double highThreshold = 0.02, double lowThreshold = 0.01, int targetPoints = 0);
+
+// Same for a frame that is already decoded in memory; false if the frame is empty
+bool detect_edges(const grayMatrix_t& frame, double highThreshold = 0.02, double lowThreshold = 0.01, int targetPoints = 0);
+
+#endif // DETECTOR_H
@@ -0,0 +1,128 @@
+#include "dump.h"
+#include "../drivers/bmp_handler.h"
+#include <bits/stdc++.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+int dumpMask = DUMP_ALL;
+
+int parse_dump_mask(const string& spec, int fallback) {
+    int mask = DUMP_NONE;
+    std::stringstream ss(spec);
+    string item;
+    while (std::getline(ss, item, ',')) {
+        std::transform(item.begin(), item.end(), item.begin(), ::tolower);
+        if (item == "none" || item.empty()) {
+            continue;
+        } else if (item == "all") {
+            mask |= DUMP_ALL;
+        } else if (item == "gray") {
+            mask |= DUMP_GRAY;
+        } else if (item == "canny") {
+            mask |= DUMP_CANNY;
+        } else if (item == "preview") {
+            mask |= DUMP_PREVIEW;
+        } else {
+            std::cerr << "Warning: unknown dump artifact '" << item << "'" << std::endl;
+            return fallback;
+        }
+    }
+    return mask;
+}
+
+void configure_dumps(int defaultMask) {
+    const char* spec = std::getenv("OSCILLO_DUMP");
+    dumpMask = spec ? parse_dump_mask(spec, defaultMask) : defaultMask;
+}
+
+bool dump_enabled(DumpArtifact artifact) {
+    return (dumpMask & artifact) != 0;
+}
+
+// Single background thread that encodes and writes queued images in order
+class DumpWriter {
+private:
+    struct Job {
+        grayMatrix_t image;
+        string filename;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Job> jobs;
+    bool busy;
+    bool stopping;
+    std::thread worker;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                break;
+            }
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            busy = true;
+            lock.unlock();
+
+            BMPImage img;
+            img.fromGrayscaleMatrix(job.image);
+            img.writeBMP(job.filename);
+
+            lock.lock();
+            busy = false;
+            if (jobs.empty()) {
+                idle.notify_all();
+            }
+        }
+    }
+
+public:
+    DumpWriter() : busy(false), stopping(false) {}
+
+    ~DumpWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    void push(const grayMatrix_t& image, const string& filename) {
+        Job job;
+        job.image = image;
+        job.filename = filename;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!worker.joinable()) {
+            worker = std::thread(&DumpWriter::run, this);
+        }
+        jobs.push_back(std::move(job));
+        wake.notify_one();
+    }
+
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [&] { return jobs.empty() && !busy; });
+    }
+};
+
+static DumpWriter writer;
+
+bool dump_image(DumpArtifact artifact, const grayMatrix_t& image, const string& filename) {
+    if (!dump_enabled(artifact) || image.empty()) {
+        return false;
+    }
+    writer.push(image, filename);
+    return true;
+}
+
+void flush_dumps() {
+    writer.flush();
+}
@@ -0,0 +1,35 @@
+#ifndef DUMP_H
+#define DUMP_H
+
+#include <string>
+#include "canny.h"
+
+using std::string;
+
+// Debug images that can be written while processing
+enum DumpArtifact {
+    DUMP_NONE = 0,
+    DUMP_GRAY = 1 << 0,      // gray.bmp from initialize()
+    DUMP_CANNY = 1 << 1,     // canny.bmp, the edge map from detect_edges()
+    DUMP_PREVIEW = 1 << 2,   // preview.bmp from preview_signal()
+    DUMP_ALL = DUMP_GRAY | DUMP_CANNY | DUMP_PREVIEW
+};
+
+// Bitmask of enabled artifacts
+extern int dumpMask;
+
+// Parses "none", "all" or a comma list such as "gray,canny"; returns fallback on bad input
+int parse_dump_mask(const string& spec, int fallback);
+
+// Sets dumpMask from the OSCILLO_DUMP environment variable, or defaultMask if unset
+void configure_dumps(int defaultMask);
+
+bool dump_enabled(DumpArtifact artifact);
+
+// Queues an image for the background writer; returns false if the artifact is disabled
+bool dump_image(DumpArtifact artifact, const grayMatrix_t& image, const string& filename);
+
+// Blocks until every queued image is on disk
+void flush_dumps();
+
+#endif // DUMP_H
@@ -0,0 +1,96 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+// Row alignment in bytes, wide enough for AVX2 loads
+const size_t IMAGE_ALIGN = 32;
+
+// Allocator returning IMAGE_ALIGN-aligned storage (portable, no posix_memalign)
+template<typename T>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    AlignedAllocator() {}
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = n * sizeof(T) + IMAGE_ALIGN + sizeof(void*);
+        void* raw = std::malloc(bytes);
+        if (raw == nullptr) {
+            throw std::bad_alloc();
+        }
+        uintptr_t base = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+        uintptr_t aligned = (base + IMAGE_ALIGN - 1) & ~(uintptr_t)(IMAGE_ALIGN - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<T*>(aligned);
+    }
+
+    void deallocate(T* p, size_t) {
+        if (p != nullptr) {
+            std::free(reinterpret_cast<void**>(p)[-1]);
+        }
+    }
+
+    template<typename U>
+    struct rebind { typedef AlignedAllocator<U> other; };
+};
+
+template<typename T, typename U>
+bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&) { return true; }
+template<typename T, typename U>
+bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&) { return false; }
+
+// Contiguous row-major image; every row starts on an IMAGE_ALIGN boundary.
+// Indexing follows the rest of the pipeline: img[row][col].
+template<typename T>
+class Image {
+private:
+    int width_;
+    int height_;
+    int stride_;   // elements between the starts of two consecutive rows
+    std::vector<T, AlignedAllocator<T>> data_;
+
+    static int alignedStride(int width) {
+        if (IMAGE_ALIGN % sizeof(T) != 0) {
+            return width;
+        }
+        int step = IMAGE_ALIGN / sizeof(T);
+        return (width + step - 1) / step * step;
+    }
+
+public:
+    Image() : width_(0), height_(0), stride_(0) {}
+    Image(int width, int height, const T& value = T())
+        : width_(width), height_(height), stride_(alignedStride(width)),
+          data_((size_t)alignedStride(width) * height, value) {}
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int stride() const { return stride_; }
+    bool empty() const { return width_ == 0 || height_ == 0; }
+
+    T* row(int y) { return data_.data() + (size_t)y * stride_; }
+    const T* row(int y) const { return data_.data() + (size_t)y * stride_; }
+    T* operator[](int y) { return row(y); }
+    const T* operator[](int y) const { return row(y); }
+
+    T* data() { return data_.data(); }
+    const T* data() const { return data_.data(); }
+
+    void fill(const T& value) { std::fill(data_.begin(), data_.end(), value); }
+
+    void clear() {
+        width_ = height_ = stride_ = 0;
+        data_.clear();
+        data_.shrink_to_fit();
+    }
+};
+
+#endif // IMAGE_H
@@ -0,0 +1,91 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include "image.h"
+
+// Compile-time convolution kernels. The taps are template arguments, so the
+// per-pixel loop is unrolled and zero taps are dropped entirely:
+//   typedef Kernel<3, 3, int, -1, 0, 1, -2, 0, 2, -1, 0, 1> SobelX;
+//   Image<int> gx = convolve<SobelX>(gray);
+
+// n-th value of a parameter pack (C++11 constexpr: single return statement)
+template<typename T>
+constexpr T pack_at(int) { return T(); }
+template<typename T, typename... Rest>
+constexpr T pack_at(int n, T first, Rest... rest) { return n == 0 ? first : pack_at<T>(n - 1, rest...); }
+
+template<int H, int W, typename T, T... Taps>
+struct Kernel {
+    static_assert(sizeof...(Taps) == H * W, "Kernel needs exactly H * W taps");
+    typedef T value_type;
+    static const int height = H;
+    static const int width = W;
+
+    // Tap at flat index i (row-major)
+    static constexpr T tap(int i) { return pack_at<T>(i, Taps...); }
+};
+
+// One multiply-add; the Zero specialization compiles to nothing
+template<bool Zero>
+struct KernelTap {
+    template<typename Acc, typename T, typename V>
+    static void add(Acc& acc, T tap, V value) { acc += tap * value; }
+};
+template<>
+struct KernelTap<true> {
+    template<typename Acc, typename T, typename V>
+    static void add(Acc&, T, V) {}
+};
+
+// Unrolls taps I .. H*W-1. Convolution flips the kernel, so input offset (ki, kj)
+// pairs with tap (H-1-ki, W-1-kj), the same as convolution2d.
+template<typename K, int I = 0, bool Done = (I == K::height * K::width)>
+struct KernelUnroll {
+    template<typename Acc, typename InputType>
+    static void accumulate(Acc& acc, const InputType* const* rows, int j) {
+        const int ki = I / K::width;
+        const int kj = I % K::width;
+        const int flipped = (K::height - 1 - ki) * K::width + (K::width - 1 - kj);
+        KernelTap<K::tap(flipped) == 0>::add(acc, K::tap(flipped), rows[ki][j + kj]);
+        KernelUnroll<K, I + 1>::accumulate(acc, rows, j);
+    }
+};
+template<typename K, int I>
+struct KernelUnroll<K, I, true> {
+    template<typename Acc, typename InputType>
+    static void accumulate(Acc&, const InputType* const*, int) {}
+};
+
+// Valid-region convolution with a compile-time kernel
+template<typename K, typename InputType>
+Image<typename K::value_type> convolve(const Image<InputType>& input) {
+    typedef typename K::value_type T;
+    int output_height = input.height() - K::height + 1;
+    int output_width = input.width() - K::width + 1;
+    if (input.empty() || output_height <= 0 || output_width <= 0) {
+        return Image<T>();
+    }
+
+    Image<T> result(output_width, output_height);
+    const InputType* rows[K::height];
+    for (int i = 0; i < output_height; i++) {
+        for (int k = 0; k < K::height; k++) {
+            rows[k] = input[i + k];
+        }
+        T* out = result[i];
+        for (int j = 0; j < output_width; j++) {
+            T sum = T();
+            KernelUnroll<K>::accumulate(sum, rows, j);
+            out[j] = sum;
+        }
+    }
+    return result;
+}
+
+// Fixed-size versions of the built-in edge kernels
+typedef Kernel<3, 3, int, -1, 0, 1, -2, 0, 2, -1, 0, 1> SobelXKernel;
+typedef Kernel<3, 3, int, -1, -2, -1, 0, 0, 0, 1, 2, 1> SobelYKernel;
+typedef Kernel<3, 3, int, -1, 0, 1, -1, 0, 1, -1, 0, 1> PrewittXKernel;
+typedef Kernel<3, 3, int, -1, -1, -1, 0, 0, 0, 1, 1, 1> PrewittYKernel;
+
+#endif // KERNEL_H
@@ -0,0 +1,68 @@
+#ifndef LUMA_H
+#define LUMA_H
+
+#include <cstdint>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// BT.601 luma in 8.8 fixed point: 0.299 / 0.587 / 0.114 scaled to 77 / 150 / 29.
+// The weights sum to 256, so gray inputs (r == g == b) map to themselves exactly.
+const int LUMA_R = 77;
+const int LUMA_G = 150;
+const int LUMA_B = 29;
+
+inline uint8_t luma(uint8_t r, uint8_t g, uint8_t b) {
+    return static_cast<uint8_t>((LUMA_R * r + LUMA_G * g + LUMA_B * b) >> 8);
+}
+
+#if defined(__SSE2__)
+// Four pixels of `step` (3 = BGR, 4 = BGRA) bytes each into one 32-bit lane apiece,
+// blue in the low byte. Reads 16 bytes from p.
+static inline __m128i luma_load4(const uint8_t* p, int step) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    if (step == 4) {
+        return v;
+    }
+    // Pixel k starts at byte 3k; shifting left by k bytes moves it to lane k
+    const __m128i lane1 = _mm_set_epi32(0, 0, -1, 0);
+    const __m128i lane2 = _mm_set_epi32(0, -1, 0, 0);
+    const __m128i lane3 = _mm_set_epi32(-1, 0, 0, 0);
+    __m128i out = _mm_and_si128(v, _mm_set_epi32(0, 0, 0, -1));
+    out = _mm_or_si128(out, _mm_and_si128(_mm_slli_si128(v, 1), lane1));
+    out = _mm_or_si128(out, _mm_and_si128(_mm_slli_si128(v, 2), lane2));
+    out = _mm_or_si128(out, _mm_and_si128(_mm_slli_si128(v, 3), lane3));
+    return out;
+}
+
+// 29b + 150g + 77r >> 8 per 32-bit lane: (b, r) and (g, x) as 16-bit pairs through madd
+static inline __m128i luma_weigh4(__m128i px) {
+    const __m128i low = _mm_set1_epi32(0x00FF00FF);
+    const __m128i br = _mm_set1_epi32((LUMA_R << 16) | LUMA_B);
+    const __m128i gx = _mm_set1_epi32(LUMA_G);
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(_mm_and_si128(px, low), br),
+                                _mm_madd_epi16(_mm_and_si128(_mm_srli_epi32(px, 8), low), gx));
+    return _mm_srli_epi32(sum, 8);
+}
+#endif
+
+// Converts `width` interleaved BGR (step 3) or BGRA (step 4) pixels to luma. Eight
+// pixels per iteration with SSE2; the vector loop never reads past src[step * width].
+inline void luma_row(const uint8_t* src, int step, uint8_t* dst, int width) {
+    int x = 0;
+#if defined(__SSE2__)
+    // Two 16-byte loads at pixels x and x + 4 reach byte 3x + 28 for BGR
+    int guard = step == 3 ? 10 : 8;
+    for (; x + guard <= width; x += 8) {
+        __m128i lo = luma_weigh4(luma_load4(src + x * step, step));
+        __m128i hi = luma_weigh4(luma_load4(src + (x + 4) * step, step));
+        __m128i packed = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(packed, packed));
+    }
+#endif
+    for (const uint8_t* p = src + x * step; x < width; x++, p += step) {
+        dst[x] = luma(p[2], p[1], p[0]);
+    }
+}
+
+#endif // LUMA_H
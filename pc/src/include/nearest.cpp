@@ -0,0 +1,197 @@
+#include "nearest.h"
+#include "delaunay.h"
+#include <bits/stdc++.h>
+
+MstEngine mst_engine = MST_DELAUNAY;
+
+void configure_mst() {
+    const char* spec = std::getenv("OSCILLO_MST");
+    if (spec == nullptr) {
+        return;
+    }
+    string name(spec);
+    if (name == "grid") {
+        mst_engine = MST_GRID;
+    } else if (name == "delaunay") {
+        mst_engine = MST_DELAUNAY;
+    } else {
+        std::cerr << "Warning: unknown OSCILLO_MST value '" << spec << "'" << std::endl;
+    }
+}
+
+// No connectivity fallback is needed: the grid engine's tree spans all components, and
+// so does the Delaunay graph, which contains that tree
+vector<distance> component_candidates(const vector<pii>& points, const Image<int>& belong, int components) {
+    if (mst_engine == MST_DELAUNAY) {
+        return delaunay_component_links(points, belong, components);
+    }
+    return grid_component_mst(points, belong, components);
+}
+
+// Grid cell side in pixels; a cell of traced edges holds a few dozen points
+const int NEAREST_CELL = 16;
+
+static int find_root(vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+// Closest foreign pixel pair found so far for one group; lo < hi are the pixels' dfn
+struct Candidate {
+    int d;
+    int lo, hi;
+
+    Candidate() : d(INT_MAX), lo(INT_MAX), hi(INT_MAX) {}
+
+    bool improved_by(int nd, int nlo, int nhi) const {
+        return nd < d || (nd == d && (nlo < lo || (nlo == lo && nhi < hi)));
+    }
+};
+
+// Lower bound of the squared distance between pixels of two cells `dr` rows and `dc`
+// columns of cells apart
+static inline long long cell_gap(int dr, int dc) {
+    long long gr = std::max(0, (std::abs(dr) - 1) * NEAREST_CELL + 1);
+    long long gc = std::max(0, (std::abs(dc) - 1) * NEAREST_CELL + 1);
+    return gr * gr + gc * gc;
+}
+
+vector<distance> grid_component_mst(const vector<pii>& points, const Image<int>& belong, int components) {
+    vector<distance> tree;
+    int n = points.size();
+    if (components < 2 || n == 0) {
+        return tree;
+    }
+
+    // Points bucketed by cell, in dfn order inside each cell
+    int rows = (belong.height() + NEAREST_CELL - 1) / NEAREST_CELL;
+    int cols = (belong.width() + NEAREST_CELL - 1) / NEAREST_CELL;
+    int cells = rows * cols;
+    vector<int> x(n), y(n), component(n), cell_of(n);
+    vector<int> cell_begin(cells + 1, 0);
+    for (int p = 0; p < n; p++) {
+        x[p] = points[p].first;
+        y[p] = points[p].second;
+        component[p] = belong[x[p]][y[p]];
+        cell_of[p] = (x[p] / NEAREST_CELL) * cols + y[p] / NEAREST_CELL;
+        cell_begin[cell_of[p] + 1]++;
+    }
+    for (int c = 0; c < cells; c++) {
+        cell_begin[c + 1] += cell_begin[c];
+    }
+    vector<int> cell_points(n);
+    vector<int> cursor(cell_begin.begin(), cell_begin.end() - 1);
+    for (int p = 0; p < n; p++) {
+        cell_points[cursor[cell_of[p]]++] = p;
+    }
+
+    const int EMPTY = -1, MIXED = -2;
+    vector<int> parent(components);
+    std::iota(parent.begin(), parent.end(), 0);
+    vector<int> group(n);              // group (union-find root) of each point this round
+    vector<int> cell_group(cells);     // the one group in a cell, or EMPTY / MIXED
+    vector<Candidate> best(components);
+    vector<int> run;
+    int groups = components;
+
+    while (groups > 1) {
+        for (int p = 0; p < n; p++) {
+            group[p] = find_root(parent, component[p]);
+        }
+        for (int c = 0; c < cells; c++) {
+            cell_group[c] = EMPTY;
+            for (int k = cell_begin[c]; k < cell_begin[c + 1]; k++) {
+                int g = group[cell_points[k]];
+                if (cell_group[c] == EMPTY) {
+                    cell_group[c] = g;
+                } else if (cell_group[c] != g) {
+                    cell_group[c] = MIXED;
+                    break;
+                }
+            }
+        }
+        std::fill(best.begin(), best.end(), Candidate());
+
+        for (int c = 0; c < cells; c++) {
+            if (cell_group[c] == EMPTY) {
+                continue;
+            }
+            run.assign(cell_points.begin() + cell_begin[c], cell_points.begin() + cell_begin[c + 1]);
+            if (cell_group[c] == MIXED) {
+                std::stable_sort(run.begin(), run.end(), [&](int a, int b) { return group[a] < group[b]; });
+            }
+
+            int cr = c / cols, cc = c % cols;
+            for (size_t first = 0; first < run.size();) {
+                int g = group[run[first]];
+                size_t last = first;
+                while (last < run.size() && group[run[last]] == g) {
+                    last++;
+                }
+
+                // Rings of cells around c, nearest first, until they cannot beat best[g]
+                Candidate& b = best[g];
+                for (int r = 0; r <= std::max(rows, cols); r++) {
+                    if (cell_gap(r, 0) > b.d) {
+                        break;
+                    }
+                    for (int tr = cr - r; tr <= cr + r; tr++) {
+                        if (tr < 0 || tr >= rows) {
+                            continue;
+                        }
+                        int step = (tr == cr - r || tr == cr + r) ? 1 : 2 * r;
+                        for (int tc = cc - r; tc <= cc + r; tc += step) {
+                            int t = tr * cols + tc;
+                            if (tc < 0 || tc >= cols || cell_group[t] == EMPTY || cell_group[t] == g
+                                || cell_gap(tr - cr, tc - cc) > b.d) {
+                                continue;
+                            }
+                            for (int k = cell_begin[t]; k < cell_begin[t + 1]; k++) {
+                                int q = cell_points[k];
+                                if (group[q] == g) {
+                                    continue;
+                                }
+                                for (size_t i = first; i < last; i++) {
+                                    int p = run[i];
+                                    int ddx = x[p] - x[q], ddy = y[p] - y[q];
+                                    int d = ddx * ddx + ddy * ddy;
+                                    int lo = std::min(p, q), hi = std::max(p, q);
+                                    if (b.improved_by(d, lo, hi)) {
+                                        b.d = d;
+                                        b.lo = lo;
+                                        b.hi = hi;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+                first = last;
+            }
+        }
+
+        // Every group's closest connection is in the tree; two groups may pick the same one
+        int joined = 0;
+        for (int g = 0; g < components; g++) {
+            if (best[g].d == INT_MAX) {
+                continue;
+            }
+            int a = find_root(parent, component[best[g].lo]);
+            int b = find_root(parent, component[best[g].hi]);
+            if (a == b) {
+                continue;
+            }
+            parent[std::max(a, b)] = std::min(a, b);
+            tree.push_back(distance(points[best[g].lo], points[best[g].hi]));
+            joined++;
+        }
+        if (joined == 0) {
+            break;
+        }
+        groups -= joined;
+    }
+    return tree;
+}
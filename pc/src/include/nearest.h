@@ -0,0 +1,37 @@
+#ifndef NEAREST_H
+#define NEAREST_H
+
+#include "constructor.h"
+
+// Pixel pairs compare by squared distance, then by the dfn of their two pixels (lower
+// first, then higher). That is a strict total order, so the spanning tree below is
+// unique, and for two components it picks the same pair as the old all-pairs scan.
+
+// Minimum spanning tree of the traced components, where two components are as far apart
+// as their closest pixel pair. Borůvka rounds over a uniform grid of the traced points:
+// every group of already joined components probes grid rings outward from its own
+// cells only until no nearer foreign pixel can exist. Returns one connection per tree
+// edge with p1 in the lower-numbered component.
+vector<distance> grid_component_mst(const vector<pii>& points, const Image<int>& belong, int components);
+
+// Candidate connections for the component spanning tree. The grid engine gives its tree
+// (components - 1 links); the Delaunay engine gives the Delaunay component graph (see
+// delaunay.h), a few links per component. prim_MST picks the same tree out of either.
+// The grid search is a little faster on ordinary traced frames but slows down when
+// groups are far apart (isolated clusters, sparse specks); the Delaunay one is
+// O(P log P) in the traced points whatever the layout, so it is the default.
+enum MstEngine {
+    MST_GRID,
+    MST_DELAUNAY
+};
+
+extern MstEngine mst_engine;
+
+// Sets mst_engine from the OSCILLO_MST environment variable ("delaunay" or "grid")
+void configure_mst();
+
+// Candidate connections with the configured engine; they always connect all components.
+// One entry per connection, p1 in the lower-numbered component.
+vector<distance> component_candidates(const vector<pii>& points, const Image<int>& belong, int components);
+
+#endif // NEAREST_H
@@ -23,6 +23,18 @@ void create_directory_if_not_exists(const std::string& path) {
     }
 }
 
+// Typical edge maps hold about this many edge pixels per pixel of the long side
+// (readme examples: ~21000 points at 1170 px)
+const int EDGE_PIXELS_PER_SIDE = 16;
+
+// Longest image side worth processing for m samples per frame: the DAC cannot resolve
+// more than DAC_LEVELS positions, and the bracket-order trace shows about m / 2 edge
+// pixels, so anything beyond m / 2 / EDGE_PIXELS_PER_SIDE is decimated away by packing
+int working_resolution(int m) {
+    int side = m / 2 / EDGE_PIXELS_PER_SIDE;
+    return std::max(std::min(side, DAC_LEVELS), 64);
+}
+
 // Function to write info data directly to play.bin file
 void write_info_to_play_bin(bool is_gif) {
     // Create SDfiles directory if it doesn't exist
@@ -72,8 +84,8 @@ void write_info_to_play_bin(bool is_gif) {
 void append_frame_to_play_bin(int m, int frame_id) {
     (void)frame_id; // Suppress unused parameter warning
     int n = signalXY.size();
-    int height = grayMatrix.size();
-    int width = grayMatrix[0].size();
+    int height = grayMatrix.height();
+    int width = grayMatrix.width();
     int scale = std::max(height, width);
     
     // Open file in append mode
@@ -83,7 +95,7 @@ void append_frame_to_play_bin(int m, int frame_id) {
     for (int i = 0; i < m; i++) {
         int idx = int(1.0 * n / m * i + 0.5);
         int x = signalXY[idx].first;
-        x = x * 1.0 / scale * (1 << 12);
+        x = x * 1.0 / scale * DAC_LEVELS;
         int u = x >> 8 & 0x0F;
         int v = x & 0xFF;
         output_file << (char) v << (char) u;
@@ -92,7 +104,7 @@ void append_frame_to_play_bin(int m, int frame_id) {
     for (int i = 0; i < m; i++) {
         int idx = int(1.0 * n / m * i + 0.5);
         int y = signalXY[idx].second;
-        y = y * 1.0 / scale * (1 << 12);
+        y = y * 1.0 / scale * DAC_LEVELS;
         int u = y >> 8 & 0x0F;
         int v = y & 0xFF;
         output_file << (char) v << (char) u;
@@ -107,8 +119,8 @@ void pack_bmp_signal(int m, vector<int> compressed[2]) {
     int n = signalXY.size();
     if (n == 0) return;
     
-    int height = grayMatrix.size();
-    int width = grayMatrix[0].size();
+    int height = grayMatrix.height();
+    int width = grayMatrix.width();
     int scale = std::max(height, width);
     
     for (int i = 0; i < m; i++) {
@@ -122,6 +134,22 @@ void pack_bmp_signal(int m, vector<int> compressed[2]) {
     }
 }
 
+// Writes info.txt for a GIF: FPS * 100, frame count and a framesize placeholder,
+// each 16-bit little endian (update_gif_info_framesize fills in the framesize)
+void write_gif_info(double fps, int frame_count) {
+    create_directory_if_not_exists("D:/OscilloProj/SDfiles");
+    std::ofstream info_file("D:/OscilloProj/SDfiles/info.txt", std::ios::binary);
+    uint16_t fields[3] = {
+        static_cast<uint16_t>(fps * 100),
+        static_cast<uint16_t>(frame_count),
+        0
+    };
+    info_file.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+    std::cout << "Frame rate: " << std::fixed << std::setprecision(2) << fps << " fps" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6) << "Total frames: " << frame_count << std::endl;
+}
+
 // Function to update framesize in info.txt for GIF files
 void update_gif_info_framesize() {
     std::string info_path = "D:/OscilloProj/SDfiles/info.txt";
@@ -142,6 +170,23 @@ void update_gif_info_framesize() {
     }
 }
 
+// Patches the frame count of an already written play.bin (and info.txt) for streams
+// whose length is only known at the end
+void update_play_bin_framecount(int frame_count) {
+    uint16_t count_16 = static_cast<uint16_t>(std::min(frame_count, 0xFFFF));
+    const char* paths[] = {"D:/OscilloProj/SDfiles/play.bin", "D:/OscilloProj/SDfiles/info.txt"};
+    for (const char* path : paths) {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!file.is_open()) {
+            std::cout << "Warning: Could not update framecount in " << path << std::endl;
+            continue;
+        }
+        file.seekp(2, std::ios::beg);
+        file.write(reinterpret_cast<const char*>(&count_16), sizeof(uint16_t));
+    }
+    std::cout << "Updated framecount=" << frame_count << " in play.bin" << std::endl;
+}
+
 // Function to initialize play.bin file for GIF processing
 void initialize_play_bin_for_gif() {
     // Update framesize in info.txt first
@@ -176,9 +221,6 @@ void compress_and_append_frame(int m, int frame_id) {
 }
 
 void pack_signal(int m) {
-    int height = grayMatrix.size();
-    int width = grayMatrix[0].size(); 
-
     // For single BMP files, use the original algorithm
     if (signalXY.size() < m)
         m = signalXY.size();
@@ -3,17 +3,23 @@
 
 #include <vector>
 
+// DAC resolution per axis (12-bit)
+const int DAC_LEVELS = 1 << 12;
+
 // External global variables
 extern std::vector<int> finalCompressed[2]; // Store final compressed result
 extern int frameSize; // Declare frameSize as external variable
 
 // Function declarations
+int working_resolution(int m);
 void compress_and_append_frame(int m, int frame_id);
 void pack_signal(int m);
 void append_frame_to_play_bin(int m, int frame_id);
 void write_info_to_play_bin(bool is_gif);
+void write_gif_info(double fps, int frame_count);
 void update_gif_info_framesize();
 void initialize_play_bin_for_gif();
+void update_play_bin_framecount(int frame_count);
 void finalize_play_bin();
 
 #endif // PACK_H
@@ -0,0 +1,98 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+// Resolves a requested worker count; 0 means one per hardware thread
+inline int resolve_threads(int requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    int hw = static_cast<int>(std::thread::hardware_concurrency());
+    return hw > 0 ? hw : 1;
+}
+
+// Number of bands parallel_bands() will use for the same arguments
+inline int band_count(int count, int threads, int min_band) {
+    if (count <= 0) {
+        return 0;
+    }
+    return std::max(1, std::min(resolve_threads(threads), count / std::max(min_band, 1)));
+}
+
+// Splits [0, count) into contiguous bands of at least min_band items and runs
+// fn(band_index, begin, end) for each band on its own thread. The calling thread
+// takes the first band, so a single band never spawns anything.
+template<typename Fn>
+int parallel_bands(int count, int threads, int min_band, Fn fn) {
+    int bands = band_count(count, threads, min_band);
+    if (bands == 0) {
+        return 0;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(bands - 1);
+    for (int b = 1; b < bands; b++) {
+        int begin = static_cast<int>(static_cast<long long>(count) * b / bands);
+        int end = static_cast<int>(static_cast<long long>(count) * (b + 1) / bands);
+        workers.push_back(std::thread(fn, b, begin, end));
+    }
+    fn(0, 0, static_cast<int>(static_cast<long long>(count) / bands));
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    return bands;
+}
+
+// Fixed-capacity FIFO between one producer and one consumer thread. push() blocks
+// while the queue is full, pop() while it is empty; after close() pop() drains what
+// is left and then returns false, and push() refuses new items.
+template<typename T>
+class BoundedQueue {
+private:
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(std::max<size_t>(capacity, 1)), closed(false) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [&] { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [&] { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+};
+
+#endif // PARALLEL_H
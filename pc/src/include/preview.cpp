@@ -1,7 +1,7 @@
 #include "preview.h"
 #include "constructor.h"
 #include "canny.h"
-#include "../drivers/bmp_handler.h"
+#include "dump.h"
 #include <bits/stdc++.h>
 
 grayMatrix_t preview;
@@ -16,8 +16,8 @@ bool connected(pii p1, pii p2) {
 
 void color(pii p, uint8_t c) {
     int x = p.first, y = p.second;
-    int height = preview.size();
-    int width = preview[0].size();
+    int height = preview.height();
+    int width = preview.width();
     
     // 边界检查
     if (x >= 0 && x < height && y >= 0 && y < width) {
@@ -63,9 +63,7 @@ void Bresenham(pii p1, pii p2) {
 }
 
 void preview_signal() {
-    int height = grayMatrix.size();
-    int width = grayMatrix[0].size();
-    preview = grayMatrix_t(height, vector<uint8_t>(width, 0));
+    preview = grayMatrix_t(grayMatrix.width(), grayMatrix.height(), 0);
 
     color(signalXY[0], 255);
     for (int i = 1; i < signalXY.size(); i++) {
@@ -76,8 +74,7 @@ void preview_signal() {
     }
     
     // 保存预览图像
-    BMPImage previewImg;
-    previewImg.fromGrayscaleMatrix(preview);
-    previewImg.writeBMP("preview.bmp");
-    std::cout << "Preview signal saved as preview.bmp" << std::endl;
+    if (dump_image(DUMP_PREVIEW, preview, "preview.bmp")) {
+        std::cout << "Preview signal saved as preview.bmp" << std::endl;
+    }
 }
@@ -0,0 +1,109 @@
+#include "thinning.h"
+#include <bits/stdc++.h>
+
+bool thinning_enabled = false;
+
+void configure_thinning() {
+    const char* spec = std::getenv("OSCILLO_THIN");
+    if (spec == nullptr) {
+        return;
+    }
+    string value = spec;
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    if (value == "1" || value == "on") {
+        thinning_enabled = true;
+    } else if (value == "0" || value == "off" || value.empty()) {
+        thinning_enabled = false;
+    } else {
+        std::cerr << "Warning: unknown OSCILLO_THIN value '" << spec << "'" << std::endl;
+    }
+}
+
+// Deletion tables for the two Zhang-Suen sub-iterations, indexed by the 8-neighbour
+// code: bit 0 = P2 (north), then clockwise up to bit 7 = P9 (north-west)
+struct ThinTables {
+    uint8_t remove[2][256];
+
+    ThinTables() {
+        for (int code = 0; code < 256; code++) {
+            int p[8];
+            int count = 0;
+            for (int k = 0; k < 8; k++) {
+                p[k] = (code >> k) & 1;
+                count += p[k];
+            }
+            int transitions = 0;
+            for (int k = 0; k < 8; k++) {
+                transitions += p[k] == 0 && p[(k + 1) % 8] == 1;
+            }
+            bool candidate = count >= 2 && count <= 6 && transitions == 1;
+            // p[0] = P2, p[2] = P4, p[4] = P6, p[6] = P8
+            remove[0][code] = candidate && !(p[0] && p[2] && p[4]) && !(p[2] && p[4] && p[6]);
+            remove[1][code] = candidate && !(p[0] && p[2] && p[6]) && !(p[0] && p[4] && p[6]);
+        }
+    }
+};
+
+// 0 / 1 copy of an edge row with one background pixel on each side. Only 255 is an edge
+// pixel, as in prune_components and the tracer; a mid-gray value from an edited
+// canny.bmp is background here too.
+static void load_row(const uint8_t* row, int width, uint8_t* buffer) {
+    for (int j = 0; j < width; j++) {
+        buffer[j + 1] = row[j] == 255;
+    }
+}
+
+// Each sub-iteration decides on the map as it was when the sub-iteration started: rows
+// are unpacked into 0 / 1 buffers before they are modified, so the row above is read
+// from its saved copy. Neighbour codes are built for a whole row at once (plain byte
+// arithmetic the compiler vectorizes), then the table lookup clears pixels.
+int thin_edges(grayMatrix_t& edges) {
+    static const ThinTables tables;
+    int height = edges.height();
+    int width = edges.width();
+    if (edges.empty()) {
+        return 0;
+    }
+
+    vector<uint8_t> above(width + 2, 0), current(width + 2, 0), below(width + 2, 0);
+    vector<uint8_t> code(width);
+    int removed = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int pass = 0; pass < 2; pass++) {
+            const uint8_t* table = tables.remove[pass];
+            std::fill(above.begin(), above.end(), 0);
+            load_row(edges[0], width, current.data());
+            for (int i = 0; i < height; i++) {
+                if (i + 1 < height) {
+                    load_row(edges[i + 1], width, below.data());
+                } else {
+                    std::fill(below.begin(), below.end(), 0);
+                }
+
+                const uint8_t* a = above.data();
+                const uint8_t* c = current.data();
+                const uint8_t* b = below.data();
+                uint8_t* k = code.data();
+                for (int j = 0; j < width; j++) {
+                    k[j] = static_cast<uint8_t>(a[j + 1] | (a[j + 2] << 1) | (c[j + 2] << 2) | (b[j + 2] << 3)
+                                                | (b[j + 1] << 4) | (b[j] << 5) | (c[j] << 6) | (a[j] << 7));
+                }
+
+                uint8_t* out = edges[i];
+                for (int j = 0; j < width; j++) {
+                    if (c[j + 1] && table[k[j]]) {
+                        out[j] = 0;
+                        removed++;
+                        changed = true;
+                    }
+                }
+
+                std::swap(above, current);
+                std::swap(current, below);
+            }
+        }
+    }
+    return removed;
+}
@@ -0,0 +1,17 @@
+#ifndef THINNING_H
+#define THINNING_H
+
+#include "canny.h"
+
+// Skeleton thinning of the edge map before tracing; off unless OSCILLO_THIN asks for it
+extern bool thinning_enabled;
+
+// Sets thinning_enabled from the OSCILLO_THIN environment variable ("1"/"on" or "0"/"off")
+void configure_thinning();
+
+// Zhang-Suen thinning of a binary (0 / 255) map down to 1-pixel skeletons, in place.
+// Pixels outside the image and values other than 255 count as background; only 255
+// pixels are ever cleared. Returns the number of pixels removed.
+int thin_edges(grayMatrix_t& edges);
+
+#endif // THINNING_H
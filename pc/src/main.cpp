@@ -1,16 +1,56 @@
 #include "drivers/bmp_handler.h"
 #include "drivers/wav_handler.h"
+#include "drivers/gif_decoder.h"
+#include "drivers/frame_stream.h"
 #include "include/canny.h"
 #include "include/constructor.h"
 #include "include/preview.h"
 #include "include/pack.h"
+#include "include/dump.h"
+#include "include/detector.h"
+#include "include/thinning.h"
+#include "include/components.h"
+#include "include/nearest.h"
+#include "include/parallel.h"
 #include <bits/stdc++.h>
 #include <cstdlib>
-#include <dirent.h>
 #include <sys/stat.h>
 
 int frameSize;
 
+// Command-line arguments answer the prompts in order, e.g. `main - 30000 0 0` for a
+// y4m stream on stdin, where the prompts could not be typed in
+std::deque<string> presetAnswers;
+
+template<typename T>
+void ask_value(T& value) {
+    if (presetAnswers.empty()) {
+        std::cin >> value;
+        return;
+    }
+    std::stringstream ss(presetAnswers.front());
+    presetAnswers.pop_front();
+    ss >> value;
+    std::cout << value << " ";
+}
+
+void ask(const string& prompt) {
+    std::cout << prompt;
+}
+
+template<typename T, typename... Rest>
+void ask(const string& prompt, T& value, Rest&... rest) {
+    bool preset = !presetAnswers.empty();
+    if (prompt.size() > 0) {
+        std::cout << prompt;
+    }
+    ask_value(value);
+    if (sizeof...(rest) == 0 && preset) {
+        std::cout << std::endl;
+    }
+    ask("", rest...);
+}
+
 bool is_gif_file(const string& filename) {
     string ext = filename.substr(filename.find_last_of('.') + 1);
     std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
@@ -22,82 +62,81 @@ bool file_exists(const string& filename) {
     return (stat(filename.c_str(), &buffer) == 0);
 }
 
-vector<string> get_bmp_files(const string& directory) {
-    vector<string> bmpFiles;
-    DIR* dir = opendir(directory.c_str());
-    if (dir == nullptr) return bmpFiles;
-    
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != nullptr) {
-        string filename = entry->d_name;
-        if (filename.length() > 4 && filename.substr(filename.length() - 4) == ".bmp") {
-            bmpFiles.push_back(directory + "/" + filename);
-        }
+// Point budget for automatic thresholds: the bracket-order trace emits every
+// edge pixel twice, so half of frameSize keeps the signal within one frame
+int auto_target_points(double highThreshold) {
+    return highThreshold <= 0 ? std::max(frameSize / 2, 1) : 0;
+}
+
+// Frames decoded ahead of the one being processed
+const int GIF_QUEUE_FRAMES = 4;
+
+// Runs one animation frame through edge detection and tracing and appends it to play.bin
+void process_frame(const grayMatrix_t& frame, int frame_id, double highThreshold, double lowThreshold, int targetPoints) {
+    // Reset all global variables
+    points.clear();
+    edges.clear();
+    signalXY.clear();
+    belong.clear();
+    dfn.clear();
+    candidates.clear();
+    mst.clear();
+
+    if (!detect_edges(frame, highThreshold, lowThreshold, targetPoints)) {
+        return;
     }
-    closedir(dir);
-    
-    std::sort(bmpFiles.begin(), bmpFiles.end());
-    return bmpFiles;
+    construct_signal();
+
+    // Compress this frame and append to final result
+    compress_and_append_frame(frameSize, frame_id);
 }
 
-void process_gif(const string& gifFile) {
+// False if the GIF can't be decoded
+bool process_gif(const string& gifFile) {
     // Get threshold values from user
     double highThreshold = 0.02;
     double lowThreshold = 0.01;
-    std::cout << "Entry high and low threshold (0.0 - 1.0): ";
-    std::cin >> highThreshold >> lowThreshold;
+    ask("Entry high and low threshold (0.0 - 1.0, 0 0 = fit frame size): ", highThreshold, lowThreshold);
+    int targetPoints = auto_target_points(highThreshold);
 
-    char flag = 'n';
-    std::cout << "Already converted gif to bmp frames? (y/n): ";
-    std::cin >> flag;
-    if (flag == 'n' || flag == 'N') {    
-        // Convert GIF to BMP frames
-        string command = "python src/gif_to_bmp.py " + gifFile;
-        int result = std::system(command.c_str());
-        if (result != 0) {
-            std::cerr << "Error converting GIF to BMP frames" << std::endl;
-            return;
-        }
-    }
-    
-    // Process each BMP frame
-    const string framesDir = "D:/OscilloProj/frames";
-    vector<string> bmpFiles = get_bmp_files(framesDir);
-    
-    if (bmpFiles.empty()) {
-        std::cerr << "No BMP files found in frames directory" << std::endl;
-        return;
+    GifDecoder decoder;
+    if (!decoder.open(gifFile)) {
+        std::cerr << "Error decoding GIF file" << std::endl;
+        return false;
     }
+    // The first frame's delay sets the frame rate; 0 means unspecified (10 fps)
+    int delay = decoder.frameDelays()[0];
+    write_gif_info(delay > 0 ? 1000.0 / delay : 10.0, decoder.frameCount());
 
-    flag = 'n';
-    std::cout << "Keep wav file? (y/n): ";
-    std::cin >> flag;
+    char flag = 'n';
+    ask("Keep wav file? (y/n): ", flag);
     
     finalCompressed[0].clear();
     finalCompressed[1].clear();
     
     // Initialize play.bin file with info data for GIF processing
     initialize_play_bin_for_gif();
+
+    // Consecutive frames share most of their tiles
+    set_animation_mode(true);
+
+    // Frames are decoded on their own thread while earlier ones are processed
+    BoundedQueue<GifFrame> queue(GIF_QUEUE_FRAMES);
+    std::thread producer([&]() {
+        GifFrame frame;
+        while (decoder.nextFrame(frame)) {
+            if (!queue.push(std::move(frame))) {
+                break;
+            }
+        }
+        queue.close();
+    });
     
     int frame_id = 0;
-    for (const string& bmpFile : bmpFiles) {
-        std::cout << "Processing " << bmpFile << " (frame " << frame_id << ")" << std::endl;
-        
-        // Reset all global variables
-        points.clear();
-        edges.clear();
-        signalXY.clear();
-        visited.clear();
-        belong.clear();
-        dfn.clear();
-        dist.clear();
-        mst.clear();
-        
-        canny(bmpFile, highThreshold, lowThreshold);
-        construct_signal();
-        
-        // Compress this frame and append to final result
-        compress_and_append_frame(frameSize, frame_id);
+    GifFrame frame;
+    while (queue.pop(frame)) {
+        std::cout << "Processing frame " << frame_id << " (" << frame.delayMs << " ms)" << std::endl;
+        process_frame(frame.gray, frame_id, highThreshold, lowThreshold, targetPoints);
         frame_id++;
 
         if (flag == 'y' || flag == 'Y') {
@@ -105,71 +144,148 @@ void process_gif(const string& gifFile) {
             finalCompressed[1].clear();
         }
     }
-    
+    producer.join();
+
+    if (frame_id < decoder.frameCount()) {
+        std::cerr << "Warning: only " << frame_id << " of " << decoder.frameCount() << " frames decoded" << std::endl;
+    }
     std::cout << "Total compressed signal length: " << finalCompressed[0].size() << std::endl;
+    active_detector().report();
+    return true;
 }
 
-void process_bmp(const string& bmpFile) {
+// Frames read ahead of the one being processed
+const int STREAM_QUEUE_FRAMES = 4;
+
+// Video frames from a y4m / gray8 stream. Memory stays constant however long the stream
+// is: a few frames are queued, and each frame's signal goes to play.bin and is dropped
+// (no play.wav). The frame count in play.bin is patched once the stream ends. False if
+// the source can't be opened.
+bool process_stream(const string& source) {
+    FrameStream stream;
+    if (!stream.open(source)) {
+        return false;
+    }
+    std::cout << "Stream " << stream.getWidth() << "x" << stream.getHeight() << std::endl;
+
     double highThreshold = 0.02;
     double lowThreshold = 0.01;
-    std::cout << "Entry high and low threshold (0.0 - 1.0): ";
-    std::cin >> highThreshold >> lowThreshold;
+    ask("Entry high and low threshold (0.0 - 1.0, 0 0 = fit frame size): ", highThreshold, lowThreshold);
+    int targetPoints = auto_target_points(highThreshold);
+
+    write_gif_info(stream.getFps(), 0);
+    initialize_play_bin_for_gif();
+    set_animation_mode(true);
+
+    BoundedQueue<grayMatrix_t> queue(STREAM_QUEUE_FRAMES);
+    std::thread producer([&]() {
+        while (true) {
+            grayMatrix_t frame;
+            if (!stream.nextFrame(frame) || !queue.push(std::move(frame))) {
+                break;
+            }
+        }
+        queue.close();
+    });
+
+    int frame_id = 0;
+    grayMatrix_t frame;
+    while (queue.pop(frame)) {
+        std::cout << "Processing frame " << frame_id << std::endl;
+        process_frame(frame, frame_id, highThreshold, lowThreshold, targetPoints);
+        finalCompressed[0].clear();
+        finalCompressed[1].clear();
+        frame_id++;
+    }
+    producer.join();
+
+    update_play_bin_framecount(frame_id);
+    finalize_play_bin();
+    active_detector().report();
+    return true;
+}
+
+// False if the image or the edited canny.bmp can't be read
+bool process_bmp(const string& bmpFile) {
+    double highThreshold = 0.02;
+    double lowThreshold = 0.01;
+    ask("Entry high and low threshold (0.0 - 1.0, 0 0 = fit frame size): ", highThreshold, lowThreshold);
     
-    canny(bmpFile, highThreshold, lowThreshold);
+    // The confirmation step below reads canny.bmp back, so it is always written
+    dumpMask |= DUMP_CANNY;
+    if (!detect_edges(bmpFile, highThreshold, lowThreshold, auto_target_points(highThreshold))) {
+        return false;
+    }
+    flush_dumps();
     
     // Confirmation step for BMP files
     char confirm;
-    std::cout << "Canny edge detection completed. Check canny.bmp file." << std::endl;
-    std::cout << "Continue with current result? (y/n): ";
-    std::cin >> confirm;
+    std::cout << "Edge detection completed. Check canny.bmp file." << std::endl;
+    ask("Continue with current result? (y/n): ", confirm);
     
     if (confirm == 'n' || confirm == 'N') {
         std::cout << "Please modify canny.bmp manually if needed, then press Enter to continue...";
         std::cin.ignore();
         std::cin.get();
         
-        // Reload canny.bmp and update grayMatrix
-        BMPImage cannyImg;
-        if (cannyImg.readBMP("canny.bmp")) {
-            if (cannyImg.isGrayscaleImage()) {
-                grayMatrix = cannyImg.toGrayscaleMatrix();
-            } else {
-                // Convert to grayscale if needed
-                const auto& colorData = cannyImg.getColorData();
-                grayMatrix = convertToGrayscaleMatrix(colorData);
-            }
+        // Reload canny.bmp and update grayMatrix; an edited color copy is converted while decoding
+        if (readBMPGray("canny.bmp", grayMatrix)) {
             std::cout << "Reloaded canny.bmp successfully." << std::endl;
-            std::cout << "Updated image size: " << grayMatrix.size() << "x" << grayMatrix[0].size() << std::endl;
+            std::cout << "Updated image size: " << grayMatrix.height() << "x" << grayMatrix.width() << std::endl;
         } else {
             std::cerr << "Error: Failed to reload canny.bmp" << std::endl;
-            return;
+            return false;
         }
     }
     
     construct_signal();
     preview_signal();
+    return true;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        presetAnswers.push_back(argv[i]);
+    }
+
     string srcFile;
-    std::cout << "Entry source file (bmp or gif): ";
-    std::cin >> srcFile;
+    ask("Entry source file (bmp, gif, y4m, - or gray8:WxH[@fps]:path): ", srcFile);
     
-    std::cout << "Entry frame size: ";
-    std::cin >> frameSize;
+    ask("Entry frame size: ", frameSize);
+    canny_max_side = working_resolution(frameSize);
+    configure_detector();
+    configure_thinning();
+    configure_pruning();
+    configure_mst();
+
+    if (isFrameStreamSource(srcFile)) {
+        configure_dumps(DUMP_NONE);
+        bool streamed = process_stream(srcFile);
+        flush_dumps();
+        return streamed ? 0 : 1;
+    }
 
     if (!file_exists(srcFile)) {
         std::cerr << "File not found: " << srcFile << std::endl;
         return 1;
     }
     
+    // Debug images are written for single BMPs; GIF batches skip them unless OSCILLO_DUMP asks
     if (is_gif_file(srcFile)) {
-        process_gif(srcFile);
+        configure_dumps(DUMP_NONE);
+        if (!process_gif(srcFile)) {
+            return 1;
+        }
     } else {
-        process_bmp(srcFile);
+        configure_dumps(DUMP_ALL);
+        if (!process_bmp(srcFile)) {
+            flush_dumps();
+            return 1;
+        }
     }
     
     pack_signal(frameSize);
+    flush_dumps();
 
     // std::cout << "max_cnt: " << max_cnt << std::endl;
     return 0;
@@ -0,0 +1,83 @@
+// Compares area_downscale against a double-precision box filter on inputs that stress
+// large shrink ratios. Run with `make check`; exits non-zero on a mismatch.
+#include "include/canny.h"
+#include <bits/stdc++.h>
+
+// Mean of the source over output sample k's interval, one axis
+static double box_axis(const vector<double>& v, int to, int k) {
+    int from = v.size();
+    double begin = static_cast<double>(k) * from / to;
+    double end = static_cast<double>(k + 1) * from / to;
+    double sum = 0;
+    for (int s = static_cast<int>(begin); s < from && s < end; s++) {
+        sum += v[s] * (std::min<double>(s + 1, end) - std::max<double>(s, begin));
+    }
+    return sum / (end - begin);
+}
+
+// 2D box filter reference, separable like the fixed-point one
+static vector<vector<double>> box_filter(const grayMatrix_t& input, int width, int height) {
+    vector<vector<double>> rows(input.height(), vector<double>(width));
+    for (int y = 0; y < input.height(); y++) {
+        vector<double> line(input[y], input[y] + input.width());
+        for (int x = 0; x < width; x++) {
+            rows[y][x] = box_axis(line, width, x);
+        }
+    }
+    vector<vector<double>> result(height, vector<double>(width));
+    for (int x = 0; x < width; x++) {
+        vector<double> column(input.height());
+        for (int y = 0; y < input.height(); y++) {
+            column[y] = rows[y][x];
+        }
+        for (int y = 0; y < height; y++) {
+            result[y][x] = box_axis(column, height, y);
+        }
+    }
+    return result;
+}
+
+static bool check(const string& name, const grayMatrix_t& input, int width, int height) {
+    grayMatrix_t output = area_downscale(input, width, height);
+    vector<vector<double>> expected = box_filter(input, width, height);
+    double worst = 0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            worst = std::max(worst, std::fabs(output[y][x] - expected[y][x]));
+        }
+    }
+    // Only the final rounding to 8 bits may differ
+    bool ok = worst <= 0.5 + 1e-3;
+    std::cout << (ok ? "ok   " : "FAIL ") << name << " (max error " << worst << ")" << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = true;
+
+    grayMatrix_t pixel(9000, 1, 0);
+    pixel[0][89] = 255;
+    ok &= check("single bright pixel 9000 -> 100", pixel, 100, 1);
+
+    for (int run : {1, 3, 7}) {
+        grayMatrix_t stripes(9000, 1);
+        for (int x = 0; x < 9000; x++) {
+            stripes[0][x] = (x / run) % 2 ? 255 : 0;
+        }
+        for (int to : {100, 128, 1000}) {
+            ok &= check("stripes of " + std::to_string(run) + " px 9000 -> " + std::to_string(to),
+                        stripes, to, 1);
+        }
+    }
+
+    grayMatrix_t grid(3000, 2100, 0);
+    for (int y = 0; y < grid.height(); y++) {
+        for (int x = 0; x < grid.width(); x++) {
+            grid[y][x] = (x % 2) ^ (y % 3 == 0) ? 255 : 0;
+        }
+    }
+    grid[1049][1500] = 128;
+    ok &= check("2D pattern 3000x2100 -> 64x45", grid, 64, 45);
+
+    return ok ? 0 : 1;
+}